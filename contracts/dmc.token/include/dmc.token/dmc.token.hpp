@@ -12,6 +12,7 @@
 
 #include <string>
 #include <cmath>
+#include <map>
 
 namespace eosio {
 
@@ -19,7 +20,6 @@ using std::string;
 
 static const name dmc_account = "dmc"_n;
 constexpr double static_weights = 10000.0;
-constexpr double uniswap_fee = 0.003;
 constexpr uint64_t uint64_max = ~uint64_t(0);
 constexpr uint32_t uint32_max = ~uint32_t(0);
 constexpr uint64_t minimum_token_precision = 0;
@@ -32,7 +32,8 @@ static constexpr symbol fee_sym = symbol(symbol_code("FEE"), 4);
 static const extended_symbol pst_sym = extended_symbol(symbol(symbol_code("PST"), 0), system_account);
 static const extended_symbol rsi_sym = extended_symbol(symbol(symbol_code("RSI"), 4), system_account);
 static const extended_symbol dmc_sym = extended_symbol(symbol(symbol_code("DMC"), 4), system_account);
-constexpr uint64_t day_sec = 24 * 3600;
+constexpr uint64_t hour_sec = 3600;
+constexpr uint64_t day_sec = 24 * hour_sec;
 constexpr uint64_t week_sec = 7 * day_sec;
 constexpr uint64_t default_dmc_claims_interval = week_sec;
 constexpr uint64_t default_order_service_epoch = 24 * week_sec;
@@ -66,8 +67,19 @@ constexpr uint64_t default_benchmark_stake_rate = 1200;
 constexpr uint64_t default_liquidation_stake_rate = 720;
 // 0.3
 constexpr uint64_t default_penalty_rate = 30;
+// a penalty is released over the hour it is paid in and the 11 hours after
+constexpr uint64_t penalty_slots = 12;
+// makers and bills walked by one liquidation call
+constexpr uint64_t default_liquidation_rows = 50;
 
 constexpr uint64_t default_bill_num_limit = 10;
+// an order / challenge receipt is a full row instead of a delta once every 16 writes of the row
+constexpr uint64_t default_full_receipt_interval = 16;
+// uniswap markets one exroute goes through
+constexpr uint64_t max_route_hops = 4;
+// swap market prices are sampled once an hour for the last day
+constexpr uint64_t oracle_interval = hour_sec;
+constexpr uint64_t oracle_slots = 24;
 
 // for abo
 static const name abo_account = "dmfoundation"_n;
@@ -180,10 +192,33 @@ typedef uint8_t MakerDistributeType;
 typedef uint8_t PriceRangeType;
 typedef uint8_t AllocationType;
 
+// layout of the events carried by batchrec
+constexpr uint8_t receipt_version = 1;
+
+template <typename, uint64_t>
+struct receipt_dispatcher;
+
+template <typename T, uint64_t Name, typename... Args>
+struct receipt_dispatcher<void (T::*)(Args...), Name> {
+    static void call(T& contract, std::tuple<std::decay_t<Args>...> args)
+    {
+        contract.add_receipt(name(Name), args);
+    }
+};
+
+/**
+ * queues a record action of the contract for the batchrec sent when the running action ends,
+ * arguments are given as to SEND_INLINE_ACTION, without the permission
+ */
+#define SEND_RECEIPT(CONTRACT, NAME, ...)                                                                               \
+    ::eosio::receipt_dispatcher<decltype(&std::decay_t<decltype(CONTRACT)>::NAME), ::eosio::name(#NAME).value>::call( \
+        (CONTRACT), __VA_ARGS__)
+
 CONTRACT token : public contract {
 
 public:
     token(name receiver, name code, datastream<const char*> ds);
+    ~token();
 
     struct nft_batch_args {
         uint64_t nft_id;
@@ -223,6 +258,12 @@ public:
 
     void exchange(name owner, extended_asset quantity, extended_asset to, double price, name id, string memo);
 
+    /**
+     * exchanges quantity along path, path[0] being its symbol, through one uniswap market per hop,
+     * fails if less than min_to of the last symbol comes out
+     */
+    ACTION exroute(name owner, extended_asset quantity, std::vector<extended_symbol> path, extended_asset min_to, string memo);
+
     ACTION exdestroy(extended_symbol sym);
 
 public:
@@ -250,6 +291,16 @@ public:
     ACTION setabostats(uint64_t stage, double user_rate, double foundation_rate, extended_asset total_release, extended_asset remaining_release, time_point_sec start_at, time_point_sec end_at, time_point_sec last_released_at);
 
     ACTION order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo);
+
+    ACTION bestorder(name owner, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo);
+
+    ACTION multiorder(name owner, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo);
+
+    ACTION syncbills(uint64_t limit);
+
+    ACTION migrateorder(uint64_t limit);
+
+    ACTION migratebill(name owner, uint64_t limit);
     
     ACTION setreserve(name owner, extended_asset dmc_quantity, extended_asset rsi_quantity);
 
@@ -281,8 +332,12 @@ public:
 
     ACTION setdmcconfig(name key, uint64_t value);
 
+    ACTION adjustprice(string memo);
+
     ACTION claimorder(name payer, uint64_t order_id);
 
+    ACTION claimorders(name payer, name owner, AccountType acc_type, uint64_t after, uint64_t limit);
+
     ACTION claimdeposit(name payer, uint64_t order_id);
 
     ACTION addordasset(name sender, uint64_t order_id, extended_asset quantity);
@@ -291,6 +346,8 @@ public:
 
     ACTION updateorder(name payer, uint64_t order_id);
 
+    ACTION settleorders(name payer, uint64_t limit);
+
     ACTION cancelorder(name sender, uint64_t order_id);
 
     ACTION nftcreatesym(extended_symbol nft_symbol, std::string symbol_uri, nft_type type);
@@ -316,6 +373,11 @@ private:
 
     void uniswapdeal(name owner, extended_asset& market_from, extended_asset& market_to, extended_asset from, extended_asset to_sym, uint64_t primary, double price, name rampay);
 
+    void uniswaproute(name owner, extended_asset quantity, const std::vector<extended_symbol>& path, extended_asset min_to, name rampay);
+
+    // moves market_from / market_to by one trade and records it, balances are left to the caller
+    void uniswaptrade(name owner, extended_asset& market_from, extended_asset& market_to, extended_asset from, extended_asset to, uint64_t price_t, extended_asset& spread_from, extended_asset& spread_to);
+
     extended_asset exchange_from_uniswap(extended_asset add_balance);
 
     /*! 
@@ -331,6 +393,16 @@ private:
 
     void increase_penalty(extended_asset quantity);
 
+public:
+    // one record action, data is packed as its arguments
+    struct receipt_event {
+        name type;
+        std::vector<char> data;
+    };
+
+    // every record event of an action, in the order they happened
+    ACTION batchrec(uint8_t version, std::vector<receipt_event> events);
+
 public:
     ACTION outreceipt(name owner, extended_asset x, extended_asset y);
     ACTION traderecord(name owner, name oppo, extended_asset from, extended_asset to, extended_asset fee, uint64_t bid_id);
@@ -370,9 +442,39 @@ private:
     bool is_challenge_end(ChallengeState state);
 
 private:
+    struct config_cache_entry {
+        uint64_t value;
+        bool exists;
+        bool dirty;
+    };
+    // dmcconfig rows read or set by the running action
+    std::map<uint64_t, config_cache_entry> _config_cache;
+    // rsi incentives of bills accrued by calbonus, exchanged once per miner by settle_incentive
+    std::map<uint64_t, std::vector<std::pair<uint64_t /* bill_id */, extended_asset /* rsi */>>> _incentive_cache;
+    // block time of the last abo / penalty release done by the running action
+    time_point_sec _abo_released_at;
+    time_point_sec _penalty_released_at;
+    // record events of the running action, sent as one batchrec by flush_receipts
+    std::vector<receipt_event> _receipts;
+
+    template <typename, uint64_t>
+    friend struct receipt_dispatcher;
+
+    template <typename Args>
+    void add_receipt(name type, const Args& args)
+    {
+        // trackers still reading the record actions themselves get both
+        if (get_dmc_config("legacyrec"_n, 0))
+            action(permission_level { _self, "active"_n }, _self, type, args).send();
+        _receipts.push_back({ type, pack(args) });
+    }
+    void flush_receipts();
+
     uint64_t get_dmc_config(name key, uint64_t default_value);
     void set_dmc_config(name key, uint64_t value);
+    void flush_dmc_config();
     double get_dmc_rate(uint64_t rate_value);
+    double get_dmc_rate(uint64_t rate_value, double benchmark_price);
     double get_benchmark_price();
 
 public:
@@ -495,6 +597,75 @@ public:
         indexed_by<"bysymbol"_n, const_mem_fun<uniswap_market, checksum256, &uniswap_market::get_key>>>
         swap_market;
 
+    struct price_observation {
+        time_point_sec at;
+        uint128_t x_cumulative;
+        uint128_t y_cumulative;
+    };
+
+    // slot ${slot} of the observation ring of the swap_oracle ${primary}, written only when a sample is taken
+    TABLE oracle_observation {
+        uint64_t id;
+        price_observation observation;
+
+        uint64_t primary_key() const { return id; }
+        static uint64_t key(uint64_t primary, uint8_t slot) { return primary * oracle_slots + slot; }
+    };
+    typedef eosio::multi_index<"oracleobs"_n, oracle_observation> oracle_observations;
+
+    /**
+     * time weighted prices of the swapmarket row with the same primary. Every change of the
+     * market's reserves updates the accumulators of this row, once an hour the sums are also
+     * sampled into the next of the oracle_slots oracle_observation rows of the market.
+     *
+     * The contract does not read the prices itself. The average price of the last ${window}
+     * seconds is twap(before(observations, primary, now - window), current(now)).
+     */
+    TABLE swap_oracle {
+        uint64_t primary;
+        time_point_sec updated_at;
+        // tokenx / tokeny and tokeny / tokenx since updated_at, 2^32 fixed point as in pricerec
+        uint64_t x_price;
+        uint64_t y_price;
+        // sums of price * seconds up to updated_at
+        uint128_t x_cumulative;
+        uint128_t y_cumulative;
+        // the newest observation is in slot cursor, taken at sampled_at (0 before the first one)
+        uint8_t cursor;
+        time_point_sec sampled_at;
+
+        uint64_t primary_key() const { return primary; }
+
+        price_observation current(time_point_sec now) const
+        {
+            uint64_t elapsed = now.sec_since_epoch() - updated_at.sec_since_epoch();
+            return { now, x_cumulative + uint128_t(x_price) * elapsed, y_cumulative + uint128_t(y_price) * elapsed };
+        }
+
+        // the newest observation of market ${primary} at or before t, at is 0 when there is none
+        static price_observation before(const oracle_observations& observations, uint64_t primary, time_point_sec t)
+        {
+            price_observation found {};
+            for (auto iter = observations.lower_bound(oracle_observation::key(primary, 0));
+                 iter != observations.end() && iter->id < oracle_observation::key(primary + 1, 0); iter++) {
+                if (iter->observation.at > found.at && iter->observation.at <= t)
+                    found = iter->observation;
+            }
+            return found;
+        }
+
+        // average tokenx / tokeny price between two observations, tokeny / tokenx if inverse
+        static uint64_t twap(const price_observation& older, const price_observation& newer, bool inverse = false)
+        {
+            uint64_t elapsed = newer.at.sec_since_epoch() - older.at.sec_since_epoch();
+            if (elapsed == 0)
+                return 0;
+            uint128_t cumulative = inverse ? newer.y_cumulative - older.y_cumulative : newer.x_cumulative - older.x_cumulative;
+            return uint64_t(cumulative / elapsed);
+        }
+    };
+    typedef eosio::multi_index<"swaporacle"_n, swap_oracle> swap_oracles;
+
     TABLE inner_uniswap_market {
         uint64_t primary;
         extended_asset tokenx;
@@ -553,6 +724,33 @@ public:
         indexed_by<"byexpire"_n, const_mem_fun<bill_record, uint64_t, &bill_record::by_expire>>>
         bill_stats;
 
+    // unmatched PST of all the bills at one price, the order book seen by `order`
+    TABLE bill_level {
+        uint64_t price;
+        uint64_t unmatched;
+        uint64_t bill_count;
+        uint64_t max_unmatched;
+
+        uint64_t primary_key() const { return price; }
+    };
+    typedef eosio::multi_index<"billlevel"_n, bill_level> bill_levels;
+
+    TABLE bill_match {
+        uint64_t bill_id;
+        uint64_t price;
+        uint64_t unmatched;
+
+        uint64_t primary_key() const { return bill_id; }
+        static uint128_t key(uint64_t price, uint64_t unmatched)
+        {
+            return ((uint128_t(price) << 64) + unmatched);
+        }
+        uint128_t by_price() const { return key(price, unmatched); }
+    };
+    typedef eosio::multi_index<"billmatch"_n, bill_match,
+        indexed_by<"byprice"_n, const_mem_fun<bill_match, uint128_t, &bill_match::by_price>>>
+        bill_matches;
+
     TABLE pst_stats {
         name owner;
         extended_asset amount;
@@ -588,6 +786,15 @@ public:
     };
     typedef eosio::multi_index<"penaltystats"_n, penalty_stats> penaltystats;
 
+    // replaces penaltystats, slot hour % penalty_slots holds the dmc still to release in that hour
+    TABLE penalty_schedule {
+        time_point_sec released_at;
+        std::array<int64_t, penalty_slots> slots;
+
+        uint64_t primary_key() const { return 0; }
+    };
+    typedef eosio::multi_index<"penaltysched"_n, penalty_schedule> penalty_schedules;
+
     TABLE dmc_config {
         name key;
         uint64_t value;
@@ -637,11 +844,116 @@ public:
             return latest_settlement_date.sec_since_epoch(); 
         }
     };
+    // orders placed before dmc_order_v2, moved over by migrateorder or on first use
     typedef eosio::multi_index<"dmcorder"_n, dmc_order,
         indexed_by<"user"_n, const_mem_fun<dmc_order, uint64_t, &dmc_order::by_user>>,
         indexed_by<"miner"_n, const_mem_fun<dmc_order, uint64_t, &dmc_order::by_miner>>,
         indexed_by<"stateid"_n, const_mem_fun<dmc_order, uint128_t, &dmc_order::by_state_id>>,
         indexed_by<"settlement"_n, const_mem_fun<dmc_order, uint64_t, &dmc_order::by_settlement_date>>>
+        dmc_orders_v1;
+
+    // dmc_order without the symbols, they are implied by the field:
+    // miner_lock_pst is PST, the rsi fields are RSI and the others are DMC
+    TABLE dmc_order_v2 {
+        uint64_t order_id;
+        name user;
+        name miner;
+        uint64_t bill_id;
+        int64_t user_pledge;
+        int64_t miner_lock_pst;
+        int64_t miner_lock_dmc;
+        int64_t price;
+        int64_t settlement_pledge;
+        int64_t lock_pledge;
+        OrderState state;
+        time_point_sec deliver_start_date;
+        time_point_sec latest_settlement_date;
+        int64_t miner_lock_rsi;
+        int64_t miner_rsi;
+        int64_t user_rsi;
+        int64_t deposit;
+        uint64_t epoch;
+        time_point_sec deposit_valid;
+        time_point_sec cancel_date;
+        // writes of the row, counted by modify_row, see full_receipt_due
+        binary_extension<uint32_t> updates;
+
+        uint64_t primary_key() const { return order_id; }
+        uint128_t by_state_id() const { return dmc_order::get_state_id(state, order_id); }
+        // the orders of an account in order id, so that claimorders can resume after one of them
+        static uint128_t get_owner_id(name owner, uint64_t order_id)
+        {
+            return ((uint128_t(owner.value) << 64) + order_id);
+        }
+        uint128_t by_user() const { return get_owner_id(user, order_id); }
+        uint128_t by_miner() const { return get_owner_id(miner, order_id); }
+        uint64_t by_settlement_date() const {
+            if (state == OrderStateWaiting) {
+                return uint64_max;
+            } else if (state == OrderStateCancel || state == OrderStateEnd) {
+                if (user_pledge || lock_pledge || deposit) {
+                    return uint64_max;
+                }
+            }
+            return latest_settlement_date.sec_since_epoch();
+        }
+
+        operator dmc_order() const
+        {
+            return dmc_order {
+                .order_id = order_id,
+                .user = user,
+                .miner = miner,
+                .bill_id = bill_id,
+                .user_pledge = extended_asset(user_pledge, dmc_sym),
+                .miner_lock_pst = extended_asset(miner_lock_pst, pst_sym),
+                .miner_lock_dmc = extended_asset(miner_lock_dmc, dmc_sym),
+                .price = extended_asset(price, dmc_sym),
+                .settlement_pledge = extended_asset(settlement_pledge, dmc_sym),
+                .lock_pledge = extended_asset(lock_pledge, dmc_sym),
+                .state = state,
+                .deliver_start_date = deliver_start_date,
+                .latest_settlement_date = latest_settlement_date,
+                .miner_lock_rsi = extended_asset(miner_lock_rsi, rsi_sym),
+                .miner_rsi = extended_asset(miner_rsi, rsi_sym),
+                .user_rsi = extended_asset(user_rsi, rsi_sym),
+                .deposit = extended_asset(deposit, dmc_sym),
+                .epoch = epoch,
+                .deposit_valid = deposit_valid,
+                .cancel_date = cancel_date,
+            };
+        }
+
+        dmc_order_v2& operator=(const dmc_order& order)
+        {
+            order_id = order.order_id;
+            user = order.user;
+            miner = order.miner;
+            bill_id = order.bill_id;
+            user_pledge = order.user_pledge.quantity.amount;
+            miner_lock_pst = order.miner_lock_pst.quantity.amount;
+            miner_lock_dmc = order.miner_lock_dmc.quantity.amount;
+            price = order.price.quantity.amount;
+            settlement_pledge = order.settlement_pledge.quantity.amount;
+            lock_pledge = order.lock_pledge.quantity.amount;
+            state = order.state;
+            deliver_start_date = order.deliver_start_date;
+            latest_settlement_date = order.latest_settlement_date;
+            miner_lock_rsi = order.miner_lock_rsi.quantity.amount;
+            miner_rsi = order.miner_rsi.quantity.amount;
+            user_rsi = order.user_rsi.quantity.amount;
+            deposit = order.deposit.quantity.amount;
+            epoch = order.epoch;
+            deposit_valid = order.deposit_valid;
+            cancel_date = order.cancel_date;
+            return *this;
+        }
+    };
+    typedef eosio::multi_index<"dmcorderv2"_n, dmc_order_v2,
+        indexed_by<"user"_n, const_mem_fun<dmc_order_v2, uint128_t, &dmc_order_v2::by_user>>,
+        indexed_by<"miner"_n, const_mem_fun<dmc_order_v2, uint128_t, &dmc_order_v2::by_miner>>,
+        indexed_by<"stateid"_n, const_mem_fun<dmc_order_v2, uint128_t, &dmc_order_v2::by_state_id>>,
+        indexed_by<"settlement"_n, const_mem_fun<dmc_order_v2, uint64_t, &dmc_order_v2::by_settlement_date>>>
         dmc_orders;
 
     TABLE dmc_challenge {
@@ -660,6 +972,8 @@ public:
         extended_asset miner_pay;
         time_point_sec challenge_date;
         name challenger;
+        // writes of the row, counted by modify_row, see full_receipt_due
+        binary_extension<uint32_t> updates;
 
         uint64_t primary_key() const { return order_id; }
     };
@@ -680,6 +994,7 @@ public:
         uint64_t by_m() const { return benchmark_stake_rate; }
         uint64_t get_n() const { return benchmark_stake_rate * 0.6; }
         double get_real_m() const { return benchmark_stake_rate / 100.0; }
+        // r / n, price independent: the maker is under-collateralized while it is below benchmark price / 100
         double by_rate() const { return current_rate / get_n(); }
     };
     typedef eosio::multi_index<"dmcmaker"_n, dmc_maker,
@@ -695,6 +1010,16 @@ public:
     };
     typedef eosio::multi_index<"makerpool"_n, maker_pool> dmc_maker_pool;
 
+    // a liquidation that ran out of rows, resumed by the next liquidation call
+    TABLE liquidation_state {
+        name miner;
+        extended_asset pst;      // pst to take from the miner
+        extended_asset leftover; // pst not yet taken from the bills
+        extended_asset penalty;
+        uint64_t primary_key() const { return miner.value; }
+    };
+    typedef eosio::multi_index<"liqstate"_n, liquidation_state> liquidation_states;
+
     TABLE price_history {
         uint64_t primary;
         uint64_t bill_id;
@@ -715,8 +1040,30 @@ public:
         indexed_by<"byorder"_n, const_mem_fun<price_history, uint64_t, &price_history::by_order_id>>>
         price_table;
 
+    // number of traced prices at each price (price * 10000) inside the pricedist window
+    TABLE price_level {
+        uint64_t price;
+        uint64_t count;
+
+        uint64_t primary_key() const { return price; }
+    };
+    typedef eosio::multi_index<"pricelevel"_n, price_level> price_levels;
+
+    // median of price_levels: `median` is the level holding the lower median,
+    // `below` the number of prices under it
+    TABLE price_stat {
+        uint64_t total;
+        uint64_t median;
+        uint64_t below;
+        uint64_t days;
+        uint64_t last_day;
+
+        uint64_t primary_key() const { return 0; }
+    };
+    typedef eosio::multi_index<"pricestat"_n, price_stat> price_stats;
+
     TABLE bc_price {
-        std::vector<double> prices;
+        std::vector<double> prices; // the one or two prices the median is taken from
         double benchmark_price;
         uint64_t primary_key() const { return 0; }
     };
@@ -737,6 +1084,35 @@ public:
     };
     typedef eosio::multi_index<"makesnapshot"_n, maker_snapshot> maker_snapshot_table;
 
+    // lp ratios of a miner's pool, shared by the orders taken while the pool does not change
+    TABLE lp_snapshot {
+        uint64_t version;
+        name miner;
+        uint64_t refs;
+        std::vector<maker_lp_pool> lps;
+        uint64_t primary_key() const { return version; }
+    };
+    typedef eosio::multi_index<"lpsnapshot"_n, lp_snapshot> lp_snapshot_table;
+
+    // the lp_snapshot new orders of a miner refer to, dropped when the pool changes
+    TABLE lp_version {
+        name miner;
+        uint64_t version;
+        uint64_t primary_key() const { return miner.value; }
+    };
+    typedef eosio::multi_index<"lpversion"_n, lp_version> lp_version_table;
+
+    // replaces maker_snapshot, version 0 means the order still has a maker_snapshot
+    TABLE order_snapshot {
+        uint64_t order_id;
+        name miner;
+        uint64_t bill_id;
+        uint64_t rate;
+        uint64_t version;
+        uint64_t primary_key() const { return order_id; }
+    };
+    typedef eosio::multi_index<"ordsnapshot"_n, order_snapshot> order_snapshot_table;
+
     struct distribute_maker_snapshot {
         name lp;
         extended_asset quantity;
@@ -747,10 +1123,20 @@ public:
     // 1: create 2: update 3: destory
     ACTION orderrec(dmc_order order_info, uint8_t type);
     ACTION challengerec(dmc_challenge challenge_info);
+    /**
+     * the fields of an order that changed since its last receipt: bit i of mask is set when field i
+     * of dmc_order changed, values holds those fields packed in field order, assets as their int64
+     * amount with the symbol of the dmc_order_v2 field
+     */
+    ACTION orderdelta(uint64_t order_id, uint32_t mask, std::vector<char> values);
+    // as orderdelta, for the fields of dmc_challenge, user_lock and miner_pay are DMC amounts, updates is not sent
+    ACTION chaldelta(uint64_t order_id, uint32_t mask, std::vector<char> values);
     ACTION billsnap(bill_record bill_info);
     ACTION makerecord(dmc_maker maker_info);
     ACTION makerpoolrec(name miner, std::vector<maker_pool> pool_info);
     ACTION makersnaprec(maker_snapshot maker_snapshot);
+    ACTION lpsnaprec(lp_snapshot snapshot);
+    ACTION ordsnaprec(order_snapshot snapshot);
     ACTION dismakerec(uint64_t order_id, std::vector<asset_type_args> rewards, extended_asset total_sub, std::vector<distribute_maker_snapshot> distribute_info);
     ACTION assetrec(uint64_t order_id, std::vector<extended_asset> changed, name owner, AssetReceiptType rec_type);
     ACTION orderassrec(uint64_t order_id, std::vector<asset_type_args> changed, name owner, AccountType acc_type, time_point_sec exec_date);
@@ -772,19 +1158,66 @@ private:
     extended_asset get_balance(extended_asset quantity, name name);
 
 private:
-    uint64_t calbonus(name owner, uint64_t primary, name ram_payer);
+    uint64_t calbonus(name owner, const bill_record& bill);
+    void close_legacy_bill(name owner, bill_stats& legacy_sst, bill_stats::const_iterator bill_iter, name payer);
+    void settle_incentive(name owner, name ram_payer);
+    // ${payer} pays for the billmatch row of a bill not indexed yet, the shared level rows are the contract's
+    void update_bill_level(uint64_t bill_id, uint64_t price, uint64_t unmatched, name payer);
+    std::pair<uint64_t, uint64_t> get_price_bounds(uint64_t benchmark_price, PriceRangeType price_range);
+    // what the user pays for ${asset} of a bill up front: its price and deposit
+    std::pair<extended_asset, extended_asset> get_fill_cost(const bill_record& bill, extended_asset asset);
+    void fill_bill(name owner, bill_stats& sst, bill_stats::const_iterator bill_iter, uint64_t epoch, extended_asset asset, extended_asset reserve, double current_price, dmc_makers& maker_tbl);
+    void update_bill_level_max(bill_levels& level_tbl, bill_matches& match_tbl, uint64_t price);
     double cal_current_rate(extended_asset dmc_asset, name owner, double real_m);
+    bool liquidate_bills(liquidation_state& liq, uint64_t& rows);
+    void finish_liquidation(const liquidation_state& liq);
+    penalty_schedule get_penalty_schedule(time_point_sec now_time);
+    void set_penalty_schedule(const penalty_schedule& schedule);
+
+    // accumulates the price the market had since the last update, then samples its new one
+    void update_oracle(const uniswap_market& market);
 
 private:
     void generate_maker_snapshot(uint64_t order_id, uint64_t bill_id, name miner, name payer, uint64_t r, bool reset = false);
-    void update_order_asset(dmc_order& order, OrderState new_state, uint64_t claims_interval);
+    void update_order_asset(dmc_order& order, OrderState new_state, uint64_t claims_interval, uint64_t periods = 1);
     void change_order(dmc_order& order, const dmc_challenge& challenge, time_point_sec current, uint64_t claims_interval, name payer);
     void update_order(dmc_order& order, const dmc_challenge& challenge, name payer);
+    dmc_orders::const_iterator find_order(dmc_orders& order_tbl, uint64_t order_id);
+    dmc_challenges::const_iterator find_challenge(dmc_challenges& challenge_tbl, uint64_t order_id);
+    // every modify of an order or challenge row goes through here, so its updates counts the writes
+    template <typename Table, typename Lambda>
+    void modify_row(Table& tbl, typename Table::const_iterator iter, name payer, Lambda&& updater)
+    {
+        tbl.modify(iter, payer, [&](auto& row) {
+            updater(row);
+            row.updates = row.updates.value_or() + 1;
+        });
+    }
+    // orderrec / challengerec when a full row is due, otherwise orderdelta / chaldelta against the last receipt
+    // ${updates} is the write count of the stored row, see dmc_order_v2::updates
+    void order_receipt(const dmc_order& order, uint8_t type, uint32_t updates = 0);
+    void order_receipt(const dmc_order_v2& order, uint8_t type) { order_receipt(order, type, order.updates.value_or()); }
+    void challenge_receipt(const dmc_challenge& challenge, bool full = false);
+    bool full_receipt_due(uint64_t order_id, uint32_t base, uint32_t updates);
+
+    // orders (with their write count) and challenges as of their last receipt, or as read by the running action
+    std::map<uint64_t, std::pair<dmc_order, uint32_t>> _order_bases;
+    std::map<uint64_t, dmc_challenge> _challenge_bases;
+    void claim_order(dmc_orders& order_tbl, dmc_orders::const_iterator order_iter, dmc_challenges& challenge_tbl, dmc_challenges::const_iterator challenge_iter, dmc_order& order_info, extended_asset miner_dmc, name payer);
     extended_asset distribute_lp_pool(uint64_t order_id, std::vector<asset_type_args> rewards, extended_asset challenge_pledge, name payer);
     void phishing_challenge();
     void delete_maker_snapshot(uint64_t order_id);
+    order_snapshot get_order_snapshot(uint64_t order_id);
+    std::vector<maker_lp_pool> get_order_lps(const order_snapshot& snapshot);
+    void expire_lp_snapshot(name miner);
     void delete_order_pst(const dmc_order& order);
     void send_totalvote_to_system(name owner);
+
+private:
+    void add_price_level(price_levels& levels, price_stat& stat, uint64_t price);
+    void sub_price_level(price_levels& levels, price_stat& stat, uint64_t price);
+    void balance_price_median(price_levels& levels, price_stat& stat);
+    price_stat init_price_stat(price_table& ptb, price_levels& levels);
 };
 
 asset token::get_supply(symbol_code sym) const
@@ -0,0 +1,166 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace eosio {
+
+/**
+ * Integer constant product math shared by the swap markets.
+ *
+ * Amounts are raw asset amounts and prices are from / to in real units as
+ * Q32 fixed point, the unit pricerec reports. Every rounding goes in favour
+ * of the market, so a market never ends below x * y after a trade:
+ *   - the side a trade moves is rounded up,
+ *   - the other side is ceil(x * y / moved side),
+ *   - the fee is ceil(out * fee_numerator / fee_denominator).
+ */
+namespace uniswap_math {
+
+    typedef unsigned __int128 uint128;
+
+    constexpr int price_bits = 32;
+    constexpr uint128 uint128_max = ~uint128(0);
+    constexpr int64_t amount_max = INT64_MAX;
+    // 0.3% of what a trade takes out stays in the market
+    constexpr uint64_t fee_numerator = 3;
+    constexpr uint64_t fee_denominator = 1000;
+
+    inline uint128 pow10(uint8_t exp)
+    {
+        uint128 r = 1;
+        while (exp--)
+            r *= 10;
+        return r;
+    }
+
+    // a * b as a 256-bit {high, low} pair
+    inline void mul_wide(uint128 a, uint128 b, uint128& high, uint128& low)
+    {
+        const uint128 mask = ~uint64_t(0);
+        uint128 a0 = a & mask, a1 = a >> 64;
+        uint128 b0 = b & mask, b1 = b >> 64;
+        uint128 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+        uint128 mid = (p00 >> 64) + (p01 & mask) + (p10 & mask);
+        low = (p00 & mask) | (mid << 64);
+        high = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    }
+
+    // a * b / c rounded down or up, saturated to uint128_max when it does not fit
+    inline uint128 mul_div(uint128 a, uint128 b, uint128 c, bool round_up = false)
+    {
+        uint128 high, low;
+        mul_wide(a, b, high, low);
+        if (high >= c)
+            return uint128_max;
+        uint128 q = 0, r = high;
+        if (high == 0) {
+            q = low / c;
+            r = low % c;
+        } else {
+            for (int i = 127; i >= 0; i--) {
+                bool carry = r >> 127;
+                r = (r << 1) | ((low >> i) & 1);
+                q <<= 1;
+                if (carry || r >= c) {
+                    r -= c;
+                    q |= 1;
+                }
+            }
+        }
+        if (round_up && r != 0)
+            q = q == uint128_max ? q : q + 1;
+        return q;
+    }
+
+    inline uint128 sqrt_floor(uint128 n)
+    {
+        if (n < 2)
+            return n;
+        uint64_t high = uint64_t(n >> 64);
+        int bits = high ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll(uint64_t(n));
+        // newton from above the root goes down to it
+        uint128 x = uint128(1) << ((bits + 1) / 2);
+        uint128 y = (x + n / x) / 2;
+        while (y < x) {
+            x = y;
+            y = (x + n / x) / 2;
+        }
+        return x;
+    }
+
+    inline uint128 sqrt_ceil(uint128 n)
+    {
+        uint128 r = sqrt_floor(n);
+        return r * r < n ? r + 1 : r;
+    }
+
+    inline int64_t to_amount(uint128 v)
+    {
+        return v > uint128(amount_max) ? amount_max : int64_t(v);
+    }
+
+    inline uint64_t to_price_t(uint128 v)
+    {
+        return v > uint128(~uint64_t(0)) ? ~uint64_t(0) : uint64_t(v);
+    }
+
+    // from / to in real units, Q32
+    inline uint128 price(int64_t from, uint8_t from_precision, int64_t to, uint8_t to_precision)
+    {
+        return mul_div(uint128(from) * pow10(to_precision), uint128(1) << price_bits, uint128(to) * pow10(from_precision));
+    }
+
+    // the other side of a from / to market once the from side moves to new_from
+    inline int64_t counter_amount(int64_t from, int64_t to, int64_t new_from)
+    {
+        return to_amount(mul_div(uint128(from) * uint128(to), 1, uint128(new_from), true));
+    }
+
+    // the from side of a from / to market trading at price_t
+    inline int64_t amount_at_price(int64_t from, uint8_t from_precision, int64_t to, uint8_t to_precision, uint64_t price_t)
+    {
+        // new_from^2 = from * to * price * 10^from_precision / 10^to_precision
+        uint128 k = uint128(from) * uint128(to);
+        uint128 square = from_precision >= to_precision
+            ? mul_div(k, uint128(price_t) * pow10(from_precision - to_precision), uint128(1) << price_bits, true)
+            : mul_div(k, price_t, pow10(to_precision - from_precision) << price_bits, true);
+        return to_amount(sqrt_ceil(square));
+    }
+
+    // sqrt(x * y), the size of a market for its lp weights
+    inline uint128 liquidity(int64_t x, int64_t y)
+    {
+        return sqrt_floor(uint128(x) * uint128(y));
+    }
+
+    /**
+     * New sides of a from / to market after a trade paying in ${in} of from, or
+     * buying ${out} of to when in is 0. A non zero limit_price_t stops the trade
+     * at that price. new_from is amount_max when the market can not fill it.
+     */
+    inline void trade(int64_t from, uint8_t from_precision, int64_t to, uint8_t to_precision, int64_t in, int64_t out, uint64_t limit_price_t, int64_t& new_from, int64_t& new_to)
+    {
+        new_from = amount_max;
+        if (in == 0) {
+            if (out < to)
+                new_from = counter_amount(to, from, to - out);
+        } else {
+            new_from = from + in;
+        }
+        if (limit_price_t != 0)
+            new_from = std::min(new_from, amount_at_price(from, from_precision, to, to_precision, limit_price_t));
+        new_to = new_from < amount_max ? counter_amount(from, to, new_from) : 0;
+    }
+
+    inline int64_t fee(int64_t out)
+    {
+        return int64_t((uint128(out) * fee_numerator + fee_denominator - 1) / fee_denominator);
+    }
+
+} // namespace uniswap_math
+} // namespace eosio
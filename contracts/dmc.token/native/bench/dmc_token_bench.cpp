@@ -0,0 +1,155 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ *
+ *  Google Benchmark suite of the hot token actions on the native build. The
+ *  argument of every benchmark is the size of the table the action walks:
+ *  bills for order and liquidation, orders for claimorder, swap markets for
+ *  the uniswap trades.
+ *
+ *    dmc_token_bench --benchmark_filter=order/1000
+ */
+#include "scenario.hpp"
+
+#include <benchmark/benchmark.h>
+
+using namespace eosio;
+using namespace eosio::scenario;
+
+namespace {
+
+/**
+ * runs ${setup} once and ${body} every iteration, the inline actions a body
+ * sends are counted and dropped outside of the timing
+ */
+template <typename S, typename F>
+void run(benchmark::State& state, S&& setup, F&& body)
+{
+    try {
+        setup_chain();
+        setup();
+        size_t inlines = 0;
+        for (auto _ : state) {
+            body();
+            state.PauseTiming();
+            inlines += host::chain().sent.size();
+            host::chain().sent.clear();
+            state.ResumeTiming();
+        }
+        state.counters["inline"] = benchmark::Counter(inlines, benchmark::Counter::kAvgIterations);
+    } catch (std::exception& e) {
+        state.SkipWithError(e.what());
+    }
+}
+
+void BM_order(benchmark::State& state)
+{
+    uint64_t bill_id = 0;
+    run(
+        state, [&]() {
+            place_bills(state.range(0));
+            bill_id = cheapest_bill();
+        },
+        [&]() { order_once(bill_id); });
+}
+
+void BM_claimorder(benchmark::State& state)
+{
+    std::vector<uint64_t> orders;
+    std::vector<std::any> settled;
+    size_t next = 0;
+    run(
+        state, [&]() {
+            place_bills(1);
+            uint64_t bill_id = cheapest_bill();
+            for (int64_t i = 0; i < state.range(0); i++)
+                order_once(bill_id);
+
+            token::dmc_orders order_tbl(token_account, token_account.value);
+            for (auto& o : order_tbl)
+                orders.push_back(o.order_id);
+            checksum256 root = checksum256::make_from_word_sequence<uint64_t>(1ul, 2ul, 3ul, 4ul);
+            for (auto order_id : orders) {
+                push(user_account, "addmerkle"_n, user_account, order_id, root, uint64_t(10));
+                push(miner_account, "addmerkle"_n, miner_account, order_id, root, uint64_t(10));
+            }
+            // two weeks of storage settled on every order
+            host::advance(days(14));
+            for (auto order_id : orders)
+                push(user_account, "updateorder"_n, user_account, order_id);
+            host::chain().sent.clear();
+            settled = save_state();
+        },
+        [&]() {
+            // each order is claimed once per pass, the next pass starts from the settled state again
+            if (next == orders.size()) {
+                state.PauseTiming();
+                restore_state(settled);
+                next = 0;
+                state.ResumeTiming();
+            }
+            push(user_account, "claimorder"_n, user_account, orders[next++]);
+        });
+}
+
+void BM_liquidation(benchmark::State& state)
+{
+    std::vector<std::any> saved;
+    run(
+        state, [&]() {
+            place_bills(state.range(0));
+            // a higher benchmark price leaves the maker short of its stake rate
+            push(config_account, "setdmcconfig"_n, "initalprice"_n, uint64_t(40));
+            host::chain().sent.clear();
+            saved = save_state();
+        },
+        [&]() {
+            push(dmc_account, "liquidation"_n, std::string(""));
+            state.PauseTiming();
+            restore_state(saved);
+            state.ResumeTiming();
+        });
+}
+
+void BM_uniswapdeal(benchmark::State& state)
+{
+    extended_symbol sym;
+    bool sell = true;
+    run(
+        state, [&]() { sym = open_markets(state.range(0)).back(); },
+        [&]() {
+            // trades back and forth so the market stays around its opening price
+            if (sell)
+                push(user_account, "exchange"_n, user_account, extended_asset(1000000, sym), extended_asset(0, dmc_sym), 0.0, name(), std::string(""));
+            else
+                push(user_account, "exchange"_n, user_account, dmc(10), extended_asset(0, sym), 0.0, name(), std::string(""));
+            sell = !sell;
+        });
+}
+
+void BM_exroute(benchmark::State& state)
+{
+    std::vector<extended_symbol> forward, backward;
+    bool out = true;
+    run(
+        state, [&]() {
+            auto syms = open_markets(std::max<int64_t>(state.range(0), 2));
+            forward = { syms.front(), dmc_sym, syms.back() };
+            backward = { syms.back(), dmc_sym, syms.front() };
+        },
+        [&]() {
+            auto& path = out ? forward : backward;
+            push(user_account, "exroute"_n, user_account, extended_asset(1000000, path.front()), path, extended_asset(0, path.back()), std::string(""));
+            out = !out;
+        });
+}
+
+} // namespace
+
+BENCHMARK(BM_order)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_claimorder)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_liquidation)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_uniswapdeal)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_exroute)->Arg(10)->Arg(100)->Arg(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,68 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ *
+ *  Runs a fixed storage, challenge, liquidation and swap scenario through the
+ *  native build and writes the database cost of every action as one JSON line,
+ *  see host::profiler. The clock and inputs are fixed, so the output of two
+ *  releases can be diffed directly:
+ *
+ *    dmc_token_profile > profile.jsonl
+ */
+#include "scenario.hpp"
+
+#include <eosio/profiler.hpp>
+
+#include <iostream>
+
+using namespace eosio;
+using namespace eosio::scenario;
+
+int main(int argc, char** argv)
+{
+    host::profiler profiler(std::cout);
+    try {
+        setup_chain();
+        place_bills(3);
+        uint64_t bill_id = cheapest_bill();
+        order_once(bill_id);
+        order_once(bill_id);
+
+        std::vector<uint64_t> orders;
+        token::dmc_orders order_tbl(token_account, token_account.value);
+        for (auto& o : order_tbl)
+            orders.push_back(o.order_id);
+
+        checksum256 root = checksum256::make_from_word_sequence<uint64_t>(1ul, 2ul, 3ul, 4ul);
+        for (auto order_id : orders) {
+            push(user_account, "addmerkle"_n, user_account, order_id, root, uint64_t(10));
+            push(miner_account, "addmerkle"_n, miner_account, order_id, root, uint64_t(10));
+        }
+
+        // a challenge the miner answers
+        checksum256 reply = checksum256::make_from_word_sequence<uint64_t>(5ul, 6ul, 7ul, 8ul);
+        auto reply_bytes = reply.extract_as_byte_array();
+        checksum256 hash_data = sha256((const char*)reply_bytes.data(), reply_bytes.size());
+        push(user_account, "reqchallenge"_n, user_account, orders.front(), uint64_t(1), hash_data, std::string("nonce"));
+        push(miner_account, "anschallenge"_n, miner_account, orders.front(), reply);
+
+        host::advance(days(14));
+        for (auto order_id : orders)
+            push(user_account, "updateorder"_n, user_account, order_id);
+        push(user_account, "claimorder"_n, user_account, orders.front());
+        push(miner_account, "claimorders"_n, miner_account, miner_account, AccountType(ACC_TYPE_MINER), uint64_t(0), uint64_t(10));
+
+        // a higher benchmark price leaves the maker short of its stake rate
+        push(config_account, "setdmcconfig"_n, "initalprice"_n, uint64_t(40));
+        push(dmc_account, "liquidation"_n, std::string(""));
+
+        auto syms = open_markets(2);
+        push(user_account, "exchange"_n, user_account, extended_asset(1000000, syms.front()), extended_asset(0, dmc_sym), 0.0, name(), std::string(""));
+        std::vector<extended_symbol> path { syms.front(), dmc_sym, syms.back() };
+        push(user_account, "exroute"_n, user_account, extended_asset(1000000, path.front()), path, extended_asset(0, path.back()), std::string(""));
+    } catch (std::exception& e) {
+        std::cerr << "dmc_token_profile: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ *
+ *  Chain setups shared by the native benchmarks and the cost profiler.
+ */
+#pragma once
+
+#include <dmc.token/dmc.token.hpp>
+#include <eosio/host.hpp>
+
+#include <any>
+
+namespace eosio {
+namespace scenario {
+
+inline const name token_account = "dmc.token"_n;
+inline const name miner_account = "miner"_n;
+inline const name user_account = "user"_n;
+
+template <typename... Args>
+void push(name actor, name act, Args... args)
+{
+    host::push_action(action(permission_level { actor, "active"_n }, token_account, act, std::make_tuple(args...)));
+}
+
+inline extended_asset dmc(int64_t amount) { return extended_asset(amount * 10000, dmc_sym); }
+inline extended_asset pst(int64_t amount) { return extended_asset(amount, pst_sym); }
+inline extended_asset rsi(int64_t amount) { return extended_asset(amount * 10000, rsi_sym); }
+
+inline void create_token(extended_symbol sym)
+{
+    push(system_account, "excreate"_n, system_account, asset(int64_t(1) << 60, sym.get_symbol()), asset(0, sym.get_symbol()), time_point_sec());
+}
+
+/**
+ * a fresh chain with dmc.token deployed, its DMC, PST and RSI and a funded miner and user.
+ * State is not snapshotted per action, so a failing action leaves its partial writes.
+ */
+inline void setup_chain()
+{
+    host::reset();
+    host::chain().rollback = false;
+    host::chain().execute_inline = true;
+    host::bind_token(token_account);
+    // swap markets are only reached from inside the contract, bound here so they can be pushed
+    host::bind(token_account, "addreserves"_n, &token::addreserves);
+    host::bind(token_account, "exchange"_n, &token::exchange);
+
+    for (auto n : { token_account, system_account, dmc_account, config_account, "dmc.ramfee"_n, miner_account, user_account })
+        host::chain().accounts.insert(n.value);
+
+    create_token(dmc_sym);
+    create_token(pst_sym);
+    create_token(rsi_sym);
+    push(config_account, "setdmcconfig"_n, "olderbillid"_n, uint64_t(1));
+    push(system_account, "setreserve"_n, system_account, dmc(1000000), rsi(1000000));
+    push(system_account, "exissue"_n, token_account, dmc(10000000), std::string("pool"));
+    push(dmc_account, "setabostats"_n, uint64_t(1), 0.6, 0.4, dmc(1000000), dmc(1000000), time_point_sec(current_time_point()), time_point_sec(current_time_point() + days(365)), time_point_sec(current_time_point()));
+    for (auto n : { miner_account, user_account }) {
+        push(system_account, "exissue"_n, n, dmc(1000000000), std::string("dmc"));
+        push(system_account, "exissue"_n, n, pst(100000000), std::string("pst"));
+    }
+    host::chain().sent.clear();
+}
+
+/**
+ * ${bills} bills of the miner, one per price level, the cheapest holding
+ * enough PST for every order placed on it
+ */
+inline void place_bills(int64_t bills)
+{
+    push(miner_account, "increase"_n, miner_account, dmc(10000000), miner_account);
+    auto expire_on = time_point_sec(current_time_point() + days(3650));
+    for (int64_t i = 0; i < bills; i++)
+        push(miner_account, "bill"_n, miner_account, pst(i == 0 ? 1000000 : 100), 1.0 + i * 0.001, expire_on, uint64_t(1), std::string(""));
+    host::advance(hours(3));
+    host::chain().sent.clear();
+}
+
+inline uint64_t cheapest_bill()
+{
+    token::bill_stats sst(token_account, token_account.value);
+    auto best = sst.begin();
+    for (auto it = sst.begin(); it != sst.end(); ++it) {
+        if (it->price < best->price)
+            best = it;
+    }
+    return best->bill_id;
+}
+
+inline uint64_t benchmark_price_t()
+{
+    token::bc_price_table bptb(token_account, token_account.value);
+    double price = bptb.begin() == bptb.end() ? default_initial_price / 100.0 : bptb.begin()->benchmark_price;
+    return std::round(price * 10000);
+}
+
+inline void order_once(uint64_t bill_id)
+{
+    push(user_account, "order"_n, user_account, bill_id, benchmark_price_t(), PriceRangeType(NoLimit), uint64_t(24), pst(1), dmc(1000), std::string(""));
+}
+
+// copies of every table, to run an action over the same state each iteration
+inline std::vector<std::any> save_state()
+{
+    std::vector<std::any> saved;
+    for (auto& s : host::stores())
+        saved.push_back(s.save());
+    return saved;
+}
+
+inline void restore_state(const std::vector<std::any>& saved)
+{
+    for (size_t i = 0; i < saved.size(); ++i)
+        host::stores()[i].restore(saved[i]);
+    for (size_t i = saved.size(); i < host::stores().size(); ++i)
+        host::stores()[i].clear();
+}
+
+// a swap market of a new token against DMC per market, symbols TKA, TKB, ...
+inline std::vector<extended_symbol> open_markets(int64_t markets)
+{
+    std::vector<extended_symbol> syms;
+    for (int64_t i = 0; i < markets; i++) {
+        std::string code = "TK";
+        for (int64_t n = i; ; n = n / 26 - 1) {
+            code.insert(2, 1, char('A' + n % 26));
+            if (n < 26)
+                break;
+        }
+        extended_symbol sym(symbol(code, 4), system_account);
+        create_token(sym);
+        push(system_account, "exissue"_n, user_account, extended_asset(int64_t(1) << 50, sym), std::string(""));
+        push(user_account, "addreserves"_n, user_account, extended_asset(100000000000, sym), dmc(100000));
+        syms.push_back(sym);
+    }
+    host::chain().sent.clear();
+    return syms;
+}
+
+} // namespace scenario
+} // namespace eosio
@@ -0,0 +1,149 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/host.hpp>
+#include <eosio/name.hpp>
+
+#include <boost/preprocessor/facilities/overload.hpp>
+#include <boost/preprocessor/tuple/enum.hpp>
+#include <boost/preprocessor/variadic/size.hpp>
+#include <boost/preprocessor/variadic/to_tuple.hpp>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+struct permission_level {
+    permission_level(name a, name p)
+        : actor(a)
+        , permission(p)
+    {
+    }
+    permission_level() { }
+
+    name actor;
+    name permission;
+
+    friend bool operator==(const permission_level& a, const permission_level& b)
+    {
+        return a.actor == b.actor && a.permission == b.permission;
+    }
+
+    EOSLIB_SERIALIZE(permission_level, (actor)(permission))
+};
+
+struct action {
+    eosio::name account;
+    eosio::name name;
+    std::vector<permission_level> authorization;
+    std::vector<char> data;
+
+    action() { }
+
+    template <typename T>
+    action(const permission_level& auth, struct name a, struct name n, T&& value)
+        : account(a)
+        , name(n)
+        , authorization(1, auth)
+        , data(pack(std::forward<T>(value)))
+    {
+    }
+
+    template <typename T>
+    action(std::vector<permission_level> auths, struct name a, struct name n, T&& value)
+        : account(a)
+        , name(n)
+        , authorization(std::move(auths))
+        , data(pack(std::forward<T>(value)))
+    {
+    }
+
+    template <typename T>
+    T data_as() const
+    {
+        return unpack<T>(data.data(), data.size());
+    }
+
+    /**
+     * Queues the action; host::push_action runs it once the sending action returns
+     */
+    void send() const;
+
+    EOSLIB_SERIALIZE(action, (account)(name)(authorization)(data))
+};
+
+template <typename, uint64_t>
+struct inline_dispatcher;
+
+template <typename T, uint64_t Name, typename... Args>
+struct inline_dispatcher<void (T::*)(Args...), Name> {
+    static void call(name code, const permission_level& perm, std::tuple<std::decay_t<Args>...> args)
+    {
+        action(perm, code, name(Name), std::move(args)).send();
+    }
+    static void call(name code, std::vector<permission_level> perms, std::tuple<std::decay_t<Args>...> args)
+    {
+        action(std::move(perms), code, name(Name), std::move(args)).send();
+    }
+};
+
+inline bool has_auth(name n)
+{
+    auto& auths = host::chain().auths;
+    return std::find(auths.begin(), auths.end(), n) != auths.end();
+}
+
+inline void require_auth(name n)
+{
+    check(has_auth(n), "missing authority of " + n.to_string());
+}
+
+inline void require_auth(const permission_level& level) { require_auth(level.actor); }
+
+inline void require_recipient(name notify_account)
+{
+    host::chain().recipients.push_back(notify_account);
+}
+
+template <typename... accounts>
+void require_recipient(name notify_account, accounts... remaining_accounts)
+{
+    require_recipient(notify_account);
+    require_recipient(remaining_accounts...);
+}
+
+inline bool is_account(name n) { return host::chain().accounts.count(n.value) > 0; }
+
+namespace host {
+
+    template <typename C, typename... Args>
+    void bind(name account, name act, void (C::*fn)(Args...))
+    {
+        handlers()[{ account.value, act.value }] = [account, fn](const action& a) {
+            auto args = a.data_as<std::tuple<std::decay_t<Args>...>>();
+            C contract(account, a.account, datastream<const char*>(a.data.data(), a.data.size()));
+            std::apply([&](auto&... values) { (contract.*fn)(values...); }, args);
+        };
+    }
+
+} // namespace host
+} // namespace eosio
+
+#define INLINE_ACTION_SENDER3(CONTRACT_CLASS, FUNCTION_NAME, ACTION_NAME) \
+    ::eosio::inline_dispatcher<decltype(&CONTRACT_CLASS::FUNCTION_NAME), ACTION_NAME>::call
+
+#define INLINE_ACTION_SENDER2(CONTRACT_CLASS, NAME) \
+    INLINE_ACTION_SENDER3(CONTRACT_CLASS, NAME, ::eosio::name(#NAME).value)
+
+#define INLINE_ACTION_SENDER(...) BOOST_PP_OVERLOAD(INLINE_ACTION_SENDER, __VA_ARGS__)(__VA_ARGS__)
+
+#define SEND_INLINE_ACTION(CONTRACT, NAME, ...)                                       \
+    INLINE_ACTION_SENDER(std::decay_t<decltype(CONTRACT)>, NAME)((CONTRACT).get_self(), \
+        BOOST_PP_TUPLE_ENUM(BOOST_PP_VARIADIC_SIZE(__VA_ARGS__), BOOST_PP_VARIADIC_TO_TUPLE(__VA_ARGS__)));
@@ -0,0 +1,237 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/symbol.hpp>
+
+#include <limits>
+#include <string>
+
+namespace eosio {
+
+/**
+ * amounts are `long long` as on wasm32, so that sources mixing `int64_t`
+ * fields with `ll` literals compile the same on the host
+ */
+struct asset {
+    long long amount = 0;
+    eosio::symbol symbol;
+
+    static constexpr long long max_amount = (1LL << 62) - 1;
+
+    asset() { }
+
+    asset(long long a, class symbol s)
+        : amount(a)
+        , symbol { s }
+    {
+        check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+        check(symbol.is_valid(), "invalid symbol name");
+    }
+
+    bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+    bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+    void set_amount(long long a)
+    {
+        amount = a;
+        check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+    }
+
+    asset operator-() const
+    {
+        asset r = *this;
+        r.amount = -r.amount;
+        return r;
+    }
+
+    asset& operator-=(const asset& a)
+    {
+        check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+        amount -= a.amount;
+        check(-max_amount <= amount, "subtraction underflow");
+        check(amount <= max_amount, "subtraction overflow");
+        return *this;
+    }
+
+    asset& operator+=(const asset& a)
+    {
+        check(a.symbol == symbol, "attempt to add asset with different symbol");
+        amount += a.amount;
+        check(-max_amount <= amount, "addition underflow");
+        check(amount <= max_amount, "addition overflow");
+        return *this;
+    }
+
+    inline friend asset operator+(const asset& a, const asset& b)
+    {
+        asset result = a;
+        result += b;
+        return result;
+    }
+
+    inline friend asset operator-(const asset& a, const asset& b)
+    {
+        asset result = a;
+        result -= b;
+        return result;
+    }
+
+    asset& operator*=(long long a)
+    {
+        __int128 tmp = (__int128)amount * (__int128)a;
+        check(tmp <= max_amount, "multiplication overflow");
+        check(tmp >= -max_amount, "multiplication underflow");
+        amount = (long long)tmp;
+        return *this;
+    }
+
+    friend asset operator*(const asset& a, long long b)
+    {
+        asset result = a;
+        result *= b;
+        return result;
+    }
+
+    asset& operator/=(long long a)
+    {
+        check(a != 0, "divide by zero");
+        check(!(amount == std::numeric_limits<long long>::min() && a == -1), "signed division overflow");
+        amount /= a;
+        return *this;
+    }
+
+    friend asset operator/(const asset& a, long long b)
+    {
+        asset result = a;
+        result /= b;
+        return result;
+    }
+
+    friend bool operator==(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount == b.amount;
+    }
+    friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+    friend bool operator<(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount < b.amount;
+    }
+    friend bool operator<=(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount <= b.amount;
+    }
+    friend bool operator>(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount > b.amount;
+    }
+    friend bool operator>=(const asset& a, const asset& b)
+    {
+        check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+        return a.amount >= b.amount;
+    }
+
+    std::string to_string() const
+    {
+        auto p = symbol.precision();
+        bool negative = amount < 0;
+        unsigned long long abs = negative ? -(unsigned long long)amount : amount;
+        unsigned long long scale = 1;
+        for (int i = 0; i < p; i++)
+            scale *= 10;
+        std::string frac = std::to_string(abs % scale + scale).substr(1);
+        std::string s = (negative ? "-" : "") + std::to_string(abs / scale);
+        if (p)
+            s += "." + frac;
+        return s + " " + symbol.code().to_string();
+    }
+};
+
+struct extended_asset {
+    asset quantity;
+    name contract;
+
+    extended_symbol get_extended_symbol() const { return extended_symbol { quantity.symbol, contract }; }
+
+    extended_asset() = default;
+
+    extended_asset(long long v, extended_symbol s)
+        : quantity(v, s.get_symbol())
+        , contract(s.get_contract())
+    {
+    }
+
+    extended_asset(asset a, name c)
+        : quantity(a)
+        , contract(c)
+    {
+    }
+
+    extended_asset operator-() const { return { -quantity, contract }; }
+
+    friend extended_asset operator-(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return { a.quantity - b.quantity, a.contract };
+    }
+
+    friend extended_asset operator+(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return { a.quantity + b.quantity, a.contract };
+    }
+
+    extended_asset& operator+=(const extended_asset& e)
+    {
+        check(contract == e.contract, "type mismatch");
+        quantity += e.quantity;
+        return *this;
+    }
+
+    extended_asset& operator-=(const extended_asset& e)
+    {
+        check(contract == e.contract, "type mismatch");
+        quantity -= e.quantity;
+        return *this;
+    }
+
+    friend bool operator<(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return a.quantity < b.quantity;
+    }
+    friend bool operator==(const extended_asset& a, const extended_asset& b)
+    {
+        return std::tie(a.quantity, a.contract) == std::tie(b.quantity, b.contract);
+    }
+    friend bool operator!=(const extended_asset& a, const extended_asset& b)
+    {
+        return std::tie(a.quantity, a.contract) != std::tie(b.quantity, b.contract);
+    }
+    friend bool operator<=(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return a.quantity <= b.quantity;
+    }
+    friend bool operator>=(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return a.quantity >= b.quantity;
+    }
+    friend bool operator>(const extended_asset& a, const extended_asset& b)
+    {
+        check(a.contract == b.contract, "type mismatch");
+        return a.quantity > b.quantity;
+    }
+
+    std::string to_string() const { return quantity.to_string() + "@" + contract.to_string(); }
+};
+
+} // namespace eosio
@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+
+#include <optional>
+#include <utility>
+
+namespace eosio {
+
+/**
+ * trailing field that may be absent from rows written by an older contract
+ */
+template <typename T>
+class binary_extension {
+public:
+    using value_type = T;
+
+    constexpr binary_extension() { }
+    constexpr binary_extension(const T& ext)
+        : _v(ext)
+    {
+    }
+    constexpr binary_extension(T&& ext)
+        : _v(std::move(ext))
+    {
+    }
+
+    constexpr bool has_value() const { return _v.has_value(); }
+
+    constexpr T& value()
+    {
+        check(_v.has_value(), "cannot get value of empty binary_extension");
+        return *_v;
+    }
+
+    constexpr const T& value() const
+    {
+        check(_v.has_value(), "cannot get value of empty binary_extension");
+        return *_v;
+    }
+
+    constexpr const T& value_or(const T& def) const { return _v.has_value() ? *_v : def; }
+    constexpr T value_or() const { return _v.has_value() ? *_v : T {}; }
+
+    constexpr T* operator->() { return &value(); }
+    constexpr const T* operator->() const { return &value(); }
+    constexpr T& operator*() { return value(); }
+    constexpr const T& operator*() const { return value(); }
+
+    template <typename... Args>
+    T& emplace(Args&&... args)
+    {
+        _v.emplace(std::forward<Args>(args)...);
+        return *_v;
+    }
+
+    void reset() { _v.reset(); }
+
+private:
+    std::optional<T> _v;
+};
+
+template <typename DataStream, typename T>
+DataStream& operator<<(DataStream& ds, const binary_extension<T>& be)
+{
+    if (be.has_value())
+        ds << be.value();
+    return ds;
+}
+
+template <typename DataStream, typename T>
+DataStream& operator>>(DataStream& ds, binary_extension<T>& be)
+{
+    if (ds.remaining()) {
+        T val;
+        ds >> val;
+        be.emplace(std::move(val));
+    }
+    return ds;
+}
+
+} // namespace eosio
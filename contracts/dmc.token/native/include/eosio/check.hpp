@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace eosio {
+
+/**
+ * thrown by check() on the host, where the wasm build would abort the transaction
+ */
+struct check_failure : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+inline void check(bool pred, const char* msg)
+{
+    if (!pred)
+        throw check_failure(msg);
+}
+
+inline void check(bool pred, const std::string& msg)
+{
+    if (!pred)
+        throw check_failure(msg);
+}
+
+inline void check(bool pred, uint64_t code)
+{
+    if (!pred)
+        throw check_failure("assertion failure with error code: " + std::to_string(code));
+}
+
+} // namespace eosio
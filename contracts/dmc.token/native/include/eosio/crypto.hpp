@@ -0,0 +1,27 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/fixed_bytes.hpp>
+
+#include <openssl/sha.h>
+
+#include <array>
+
+namespace eosio {
+
+inline checksum256 sha256(const char* data, uint32_t length)
+{
+    std::array<uint8_t, 32> digest;
+    SHA256(reinterpret_cast<const unsigned char*>(data), length, digest.data());
+    return checksum256(digest);
+}
+
+inline void assert_sha256(const char* data, uint32_t length, const checksum256& hash)
+{
+    check(sha256(data, length) == hash, "hash mismatch");
+}
+
+} // namespace eosio
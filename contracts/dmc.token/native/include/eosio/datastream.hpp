@@ -0,0 +1,546 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/name.hpp>
+#include <eosio/reflect.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+template <typename T>
+class datastream {
+public:
+    datastream(T start, size_t s)
+        : _start(start)
+        , _pos(start)
+        , _end(start + s)
+    {
+    }
+
+    void skip(size_t s) { _pos += s; }
+
+    bool read(char* d, size_t s)
+    {
+        check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+        memcpy(d, _pos, s);
+        _pos += s;
+        return true;
+    }
+
+    bool write(const char* d, size_t s)
+    {
+        check(_end - _pos >= (int32_t)s, "datastream attempted to write past the end");
+        memcpy((void*)_pos, d, s);
+        _pos += s;
+        return true;
+    }
+
+    bool write(char d)
+    {
+        check(_end - _pos >= 1, "datastream attempted to write past the end");
+        *_pos++ = d;
+        return true;
+    }
+
+    bool put(char c) { return write(c); }
+
+    bool get(unsigned char& c) { return get(*(char*)&c); }
+
+    bool get(char& c)
+    {
+        check(_pos < _end, "datastream attempted to read past the end");
+        c = *_pos;
+        ++_pos;
+        return true;
+    }
+
+    T pos() const { return _pos; }
+    bool valid() const { return _pos <= _end && _pos >= _start; }
+    bool seekp(size_t p)
+    {
+        _pos = _start + p;
+        return _pos <= _end;
+    }
+    size_t tellp() const { return size_t(_pos - _start); }
+    size_t remaining() const { return _end - _pos; }
+
+private:
+    T _start;
+    T _pos;
+    T _end;
+};
+
+template <>
+class datastream<size_t> {
+public:
+    datastream(size_t init_size = 0)
+        : _size(init_size)
+    {
+    }
+    bool skip(size_t s)
+    {
+        _size += s;
+        return true;
+    }
+    bool write(const char*, size_t s)
+    {
+        _size += s;
+        return true;
+    }
+    bool write(char)
+    {
+        _size++;
+        return true;
+    }
+    bool put(char)
+    {
+        ++_size;
+        return true;
+    }
+    bool valid() const { return true; }
+    bool seekp(size_t p)
+    {
+        _size = p;
+        return true;
+    }
+    size_t tellp() const { return _size; }
+    size_t remaining() const { return 0; }
+
+private:
+    size_t _size;
+};
+
+template <typename T>
+struct is_datastream : std::false_type { };
+template <typename T>
+struct is_datastream<datastream<T>> : std::true_type { };
+
+struct unsigned_int {
+    unsigned_int(uint32_t v = 0)
+        : value(v)
+    {
+    }
+    operator uint32_t() const { return value; }
+    uint32_t value;
+};
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const unsigned_int& v)
+{
+    uint64_t val = v.value;
+    do {
+        uint8_t b = uint8_t(val) & 0x7f;
+        val >>= 7;
+        b |= ((val > 0) << 7);
+        ds.write((char)b);
+    } while (val);
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, unsigned_int& vi)
+{
+    uint64_t v = 0;
+    char b = 0;
+    uint8_t by = 0;
+    do {
+        ds.get(b);
+        v |= uint32_t(uint8_t(b) & 0x7f) << by;
+        by += 7;
+    } while (uint8_t(b) & 0x80);
+    vi.value = static_cast<uint32_t>(v);
+    return ds;
+}
+
+// arithmetic
+template <typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>* = nullptr>
+DataStream& operator<<(DataStream& ds, const T& v)
+{
+    ds.write((const char*)&v, sizeof(T));
+    return ds;
+}
+
+template <typename DataStream, typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>* = nullptr>
+DataStream& operator>>(DataStream& ds, T& v)
+{
+    ds.read((char*)&v, sizeof(T));
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const uint128_t& v)
+{
+    ds.write((const char*)&v, sizeof(v));
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, uint128_t& v)
+{
+    ds.read((char*)&v, sizeof(v));
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const int128_t& v)
+{
+    ds.write((const char*)&v, sizeof(v));
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, int128_t& v)
+{
+    ds.read((char*)&v, sizeof(v));
+    return ds;
+}
+
+// eosio types
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const name& v)
+{
+    return ds << v.value;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, name& v)
+{
+    return ds >> v.value;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const symbol_code& v)
+{
+    return ds << v.raw();
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, symbol_code& v)
+{
+    uint64_t raw = 0;
+    ds >> raw;
+    v = symbol_code(raw);
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const symbol& v)
+{
+    return ds << v.raw();
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, symbol& v)
+{
+    uint64_t raw = 0;
+    ds >> raw;
+    v = symbol(raw);
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const extended_symbol& v)
+{
+    return ds << v.get_symbol() << v.get_contract();
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, extended_symbol& v)
+{
+    symbol s;
+    name c;
+    ds >> s >> c;
+    v = extended_symbol(s, c);
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const asset& v)
+{
+    return ds << v.amount << v.symbol;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, asset& v)
+{
+    return ds >> v.amount >> v.symbol;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const extended_asset& v)
+{
+    return ds << v.quantity << v.contract;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, extended_asset& v)
+{
+    return ds >> v.quantity >> v.contract;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const microseconds& v)
+{
+    return ds << v._count;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, microseconds& v)
+{
+    return ds >> v._count;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const time_point& v)
+{
+    return ds << v.elapsed;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, time_point& v)
+{
+    return ds >> v.elapsed;
+}
+
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const time_point_sec& v)
+{
+    return ds << v.utc_seconds;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, time_point_sec& v)
+{
+    return ds >> v.utc_seconds;
+}
+
+template <typename DataStream, size_t Size>
+DataStream& operator<<(DataStream& ds, const fixed_bytes<Size>& d)
+{
+    auto arr = d.extract_as_byte_array();
+    ds.write((const char*)arr.data(), arr.size());
+    return ds;
+}
+
+template <typename DataStream, size_t Size>
+DataStream& operator>>(DataStream& ds, fixed_bytes<Size>& d)
+{
+    std::array<uint8_t, Size> arr;
+    ds.read((char*)arr.data(), arr.size());
+    d = fixed_bytes<Size>(arr);
+    return ds;
+}
+
+// containers
+template <typename DataStream>
+DataStream& operator<<(DataStream& ds, const std::string& v)
+{
+    ds << unsigned_int(v.size());
+    if (v.size())
+        ds.write(v.data(), v.size());
+    return ds;
+}
+
+template <typename DataStream>
+DataStream& operator>>(DataStream& ds, std::string& v)
+{
+    unsigned_int s;
+    ds >> s;
+    v.resize(s.value);
+    if (s.value)
+        ds.read(v.data(), v.size());
+    return ds;
+}
+
+template <typename DataStream, typename T>
+DataStream& operator<<(DataStream& ds, const std::vector<T>& v)
+{
+    ds << unsigned_int(v.size());
+    for (const auto& i : v)
+        ds << i;
+    return ds;
+}
+
+template <typename DataStream, typename T>
+DataStream& operator>>(DataStream& ds, std::vector<T>& v)
+{
+    unsigned_int s;
+    ds >> s;
+    v.resize(s.value);
+    for (auto& i : v)
+        ds >> i;
+    return ds;
+}
+
+template <typename DataStream, typename T, size_t N>
+DataStream& operator<<(DataStream& ds, const std::array<T, N>& v)
+{
+    for (const auto& i : v)
+        ds << i;
+    return ds;
+}
+
+template <typename DataStream, typename T, size_t N>
+DataStream& operator>>(DataStream& ds, std::array<T, N>& v)
+{
+    for (auto& i : v)
+        ds >> i;
+    return ds;
+}
+
+template <typename DataStream, typename T>
+DataStream& operator<<(DataStream& ds, const std::optional<T>& v)
+{
+    char valid = v.has_value();
+    ds << valid;
+    if (valid)
+        ds << *v;
+    return ds;
+}
+
+template <typename DataStream, typename T>
+DataStream& operator>>(DataStream& ds, std::optional<T>& v)
+{
+    char valid = 0;
+    ds >> valid;
+    if (valid) {
+        T val;
+        ds >> val;
+        v = val;
+    } else {
+        v.reset();
+    }
+    return ds;
+}
+
+template <typename DataStream, typename K, typename V>
+DataStream& operator<<(DataStream& ds, const std::pair<K, V>& t)
+{
+    return ds << std::get<0>(t) << std::get<1>(t);
+}
+
+template <typename DataStream, typename K, typename V>
+DataStream& operator>>(DataStream& ds, std::pair<K, V>& t)
+{
+    return ds >> std::get<0>(t) >> std::get<1>(t);
+}
+
+template <typename DataStream, typename K, typename V>
+DataStream& operator<<(DataStream& ds, const std::map<K, V>& m)
+{
+    ds << unsigned_int(m.size());
+    for (const auto& i : m)
+        ds << i.first << i.second;
+    return ds;
+}
+
+template <typename DataStream, typename K, typename V>
+DataStream& operator>>(DataStream& ds, std::map<K, V>& m)
+{
+    m.clear();
+    unsigned_int s;
+    ds >> s;
+    for (uint32_t i = 0; i < s.value; ++i) {
+        K k;
+        V v;
+        ds >> k >> v;
+        m.emplace(std::move(k), std::move(v));
+    }
+    return ds;
+}
+
+template <typename DataStream, typename... Args>
+DataStream& operator<<(DataStream& ds, const std::tuple<Args...>& t)
+{
+    std::apply([&](const auto&... a) { ((ds << a), ...); }, t);
+    return ds;
+}
+
+template <typename DataStream, typename... Args>
+DataStream& operator>>(DataStream& ds, std::tuple<Args...>& t)
+{
+    std::apply([&](auto&... a) { ((ds >> a), ...); }, t);
+    return ds;
+}
+
+// aggregates without EOSLIB_SERIALIZE, see reflect.hpp
+template <typename DataStream, typename T, std::enable_if_t<reflect::is_reflectable_v<T> && is_datastream<DataStream>::value>* = nullptr>
+DataStream& operator<<(DataStream& ds, const T& v)
+{
+    reflect::for_each_field(v, [&](const auto& field) { ds << field; });
+    return ds;
+}
+
+template <typename DataStream, typename T, std::enable_if_t<reflect::is_reflectable_v<T> && is_datastream<DataStream>::value>* = nullptr>
+DataStream& operator>>(DataStream& ds, T& v)
+{
+    reflect::for_each_field(v, [&](auto& field) { ds >> field; });
+    return ds;
+}
+
+template <typename T>
+size_t pack_size(const T& value)
+{
+    datastream<size_t> ps;
+    ps << value;
+    return ps.tellp();
+}
+
+template <typename T>
+std::vector<char> pack(const T& value)
+{
+    std::vector<char> result;
+    result.resize(pack_size(value));
+    datastream<char*> ds(result.data(), result.size());
+    ds << value;
+    return result;
+}
+
+template <typename T>
+T unpack(const char* buffer, size_t len)
+{
+    T result;
+    datastream<const char*> ds(buffer, len);
+    ds >> result;
+    return result;
+}
+
+template <typename T>
+T unpack(const std::vector<char>& bytes)
+{
+    return unpack<T>(bytes.data(), bytes.size());
+}
+
+} // namespace eosio
+
+#define EOSLIB_REFLECT_MEMBER_OP(r, OP, elem) \
+    OP t.elem
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                  \
+    template <typename DataStream>                                       \
+    friend DataStream& operator<<(DataStream& ds, const TYPE& t)         \
+    {                                                                    \
+        return ds BOOST_PP_SEQ_FOR_EACH(EOSLIB_REFLECT_MEMBER_OP, <<, MEMBERS); \
+    }                                                                    \
+    template <typename DataStream>                                       \
+    friend DataStream& operator>>(DataStream& ds, TYPE& t)               \
+    {                                                                    \
+        return ds BOOST_PP_SEQ_FOR_EACH(EOSLIB_REFLECT_MEMBER_OP, >>, MEMBERS); \
+    }
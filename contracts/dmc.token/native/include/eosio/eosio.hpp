@@ -0,0 +1,32 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
+#include <eosio/check.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/system.hpp>
+#include <eosio/time.hpp>
+
+#ifndef ACTION
+#define ACTION [[eosio::action]] void
+#endif
+
+#ifndef TABLE
+#define TABLE struct [[eosio::table]]
+#endif
+
+#ifndef CONTRACT
+#define CONTRACT class [[eosio::contract]]
+#endif
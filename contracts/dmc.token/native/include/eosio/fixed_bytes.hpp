@@ -0,0 +1,146 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+namespace eosio {
+
+/**
+ * Fixed size byte array stored as 128-bit words, the same layout the cdt uses
+ */
+template <size_t Size>
+class fixed_bytes {
+private:
+    static constexpr size_t count_words(size_t sz) { return (sz / 16) + (sz % 16 > 0); }
+
+public:
+    typedef uint128_t word_t;
+    static constexpr size_t num_words() { return count_words(Size); }
+    static constexpr size_t padded_bytes() { return num_words() * 16 - Size; }
+
+    constexpr fixed_bytes()
+        : _data()
+    {
+    }
+
+    fixed_bytes(const std::array<word_t, num_words()>& arr)
+        : _data(arr)
+    {
+    }
+
+    fixed_bytes(const std::array<uint8_t, Size>& arr)
+    {
+        _data = {};
+        set_from_word_sequence(arr.data(), *this);
+    }
+
+    template <typename Word, size_t NumWords>
+    fixed_bytes(const std::array<Word, NumWords>& arr)
+    {
+        static_assert(sizeof(word_t) == (sizeof(word_t) / sizeof(Word)) * sizeof(Word),
+            "size of the backing word size is not divisible by the size of the array element");
+        static_assert(sizeof(Word) * NumWords <= Size, "too many words supplied to fixed_bytes constructor");
+        _data = {};
+        set_from_word_sequence(arr.data(), arr.size(), *this);
+    }
+
+    template <typename Word, typename... Rest>
+    static fixed_bytes<Size> make_from_word_sequence(Word first_word, Rest... rest)
+    {
+        static_assert(sizeof(word_t) == (sizeof(word_t) / sizeof(Word)) * sizeof(Word),
+            "size of the backing word size is not divisible by the size of the words supplied as arguments");
+        static_assert(sizeof(Word) * (1 + sizeof...(Rest)) <= Size, "too many words supplied to make_from_word_sequence");
+
+        fixed_bytes<Size> key;
+        std::array<Word, 1 + sizeof...(Rest)> words { first_word, rest... };
+        set_from_word_sequence(words.data(), words.size(), key);
+        return key;
+    }
+
+    const auto& get_array() const { return _data; }
+    auto data() { return _data.data(); }
+    auto data() const { return _data.data(); }
+    auto size() const { return _data.size(); }
+
+    std::array<uint8_t, Size> extract_as_byte_array() const
+    {
+        std::array<uint8_t, Size> arr;
+        const size_t num_sub_words = sizeof(word_t);
+        auto arr_itr = arr.begin();
+        auto data_itr = _data.begin();
+        for (size_t counter = _data.size(); counter > 0; --counter, ++data_itr) {
+            size_t sub_words_left = num_sub_words;
+            auto temp_word = *data_itr;
+            if (counter == 1) {
+                sub_words_left -= padded_bytes();
+                temp_word >>= 8 * padded_bytes();
+            }
+            for (; sub_words_left > 0; --sub_words_left) {
+                *(arr_itr + sub_words_left - 1) = static_cast<uint8_t>(temp_word & 0xFF);
+                temp_word >>= 8;
+            }
+            arr_itr += num_sub_words;
+        }
+        return arr;
+    }
+
+    friend bool operator==(const fixed_bytes& a, const fixed_bytes& b) { return a._data == b._data; }
+    friend bool operator!=(const fixed_bytes& a, const fixed_bytes& b) { return a._data != b._data; }
+    friend bool operator<(const fixed_bytes& a, const fixed_bytes& b) { return a._data < b._data; }
+    friend bool operator<=(const fixed_bytes& a, const fixed_bytes& b) { return a._data <= b._data; }
+    friend bool operator>(const fixed_bytes& a, const fixed_bytes& b) { return a._data > b._data; }
+    friend bool operator>=(const fixed_bytes& a, const fixed_bytes& b) { return a._data >= b._data; }
+
+private:
+    template <typename Word>
+    static void set_from_word_sequence(const Word* arr_begin, size_t arr_size, fixed_bytes<Size>& key)
+    {
+        auto itr = key._data.begin();
+        word_t temp_word = 0;
+        const size_t sub_word_shift = 8 * sizeof(Word);
+        const size_t num_sub_words = sizeof(word_t) / sizeof(Word);
+        auto sub_words_left = num_sub_words;
+        for (size_t i = 0; i < arr_size; ++i) {
+            if (sub_words_left > 1) {
+                temp_word |= static_cast<word_t>(arr_begin[i]);
+                temp_word <<= sub_word_shift;
+                --sub_words_left;
+                continue;
+            }
+            temp_word |= static_cast<word_t>(arr_begin[i]);
+            sub_words_left = num_sub_words;
+            *itr = temp_word;
+            temp_word = 0;
+            ++itr;
+        }
+        if (sub_words_left != num_sub_words) {
+            if (sub_words_left > 1)
+                temp_word <<= 8 * (sub_words_left - 1);
+            *itr = temp_word;
+        }
+    }
+
+    static void set_from_word_sequence(const uint8_t* bytes, fixed_bytes<Size>& key)
+    {
+        set_from_word_sequence(bytes, Size, key);
+    }
+
+    std::array<word_t, num_words()> _data;
+};
+
+typedef fixed_bytes<20> checksum160;
+typedef fixed_bytes<32> checksum256;
+typedef fixed_bytes<64> checksum512;
+
+} // namespace eosio
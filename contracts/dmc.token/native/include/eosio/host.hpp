@@ -0,0 +1,165 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+
+#include <any>
+#include <functional>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+struct permission_level;
+struct action;
+
+/**
+ * In-memory stand-in for the chain state the intrinsics talk to on nodeos:
+ * contract tables, the block clock, authorizations of the running action and
+ * the inline actions it sends.
+ */
+namespace host {
+
+    using bytes = std::vector<char>;
+
+    struct table_id {
+        uint64_t code;
+        uint64_t scope;
+        uint64_t table;
+
+        friend bool operator<(const table_id& a, const table_id& b)
+        {
+            return std::tie(a.code, a.scope, a.table) < std::tie(b.code, b.scope, b.table);
+        }
+    };
+
+    struct row {
+        name payer;
+        bytes data;
+    };
+
+    using primary_table = std::map<uint64_t, row>;
+
+    template <typename Key>
+    struct secondary_table {
+        std::set<std::pair<Key, uint64_t>> entries;
+        std::map<uint64_t, Key> keys;
+    };
+
+    struct store_hooks {
+        std::function<std::any()> save;
+        std::function<void(const std::any&)> restore;
+        std::function<void()> clear;
+    };
+
+    std::vector<store_hooks>& stores();
+
+    template <typename T>
+    class store {
+    public:
+        static std::map<table_id, T>& tables()
+        {
+            static std::map<table_id, T>* instance = []() {
+                auto* t = new std::map<table_id, T>();
+                stores().push_back({ [t]() { return std::any(*t); },
+                    [t](const std::any& a) { *t = std::any_cast<const std::map<table_id, T>&>(a); },
+                    [t]() { t->clear(); } });
+                return t;
+            }();
+            return *instance;
+        }
+
+        static T* find(const table_id& id)
+        {
+            auto& t = tables();
+            auto it = t.find(id);
+            return it == t.end() ? nullptr : &it->second;
+        }
+
+        static T& get(const table_id& id) { return tables()[id]; }
+    };
+
+    using primary_store = store<primary_table>;
+
+    template <typename Key>
+    using secondary_store = store<secondary_table<Key>>;
+
+    /**
+     * Hooks fired by push_action, the database layer and, in a DMC_PROFILE
+     * build, get_dmc_config. Used by the cost profiler
+     */
+    struct db_observer {
+        virtual ~db_observer() { }
+        virtual void on_action(const action& act) { }
+        virtual void on_action_end(const action& act, bool failed) { }
+        virtual void on_db(const char* op, uint64_t table, uint64_t index, size_t bytes) { }
+        virtual void on_inline(name account, name act, size_t bytes) { }
+        virtual void on_config(name key) { }
+    };
+
+    struct state {
+        time_point now = time_point(seconds(1600000000));
+        uint32_t tapos_num = 1;
+        uint32_t tapos_prefix = 1;
+        std::vector<name> auths;
+        std::vector<name> recipients;
+        std::set<uint64_t> accounts;
+        std::vector<action> sent;
+        bool execute_inline = true;
+        // undo the tables of an action that fails, benchmarks turn it off to skip the snapshots
+        bool rollback = true;
+        db_observer* observer = nullptr;
+    };
+
+    state& chain();
+
+    using handler = std::function<void(const action&)>;
+
+    std::map<std::pair<uint64_t, uint64_t>, handler>& handlers();
+
+    /**
+     * Registers a contract method so that pushed and inline actions with the
+     * same name are dispatched to it, e.g. `bind("dmc.token"_n, "order"_n, &token::order)`.
+     */
+    template <typename C, typename... Args>
+    void bind(name account, name act, void (C::*fn)(Args...));
+
+    /**
+     * Runs an action with the authorizations it carries and, depth first,
+     * the inline actions it sends. State is rolled back if any of them fails.
+     */
+    void push_action(const action& act);
+
+    void reset();
+
+    /**
+     * Binds every action of the dmc.token contract deployed at ${account}, the
+     * native counterpart of the dispatcher eosio.cdt generates.
+     */
+    void bind_token(name account);
+
+    void set_time(time_point t);
+    void advance(microseconds m);
+
+    inline void notify_db(const char* op, uint64_t table, uint64_t index, size_t bytes)
+    {
+        if (chain().observer)
+            chain().observer->on_db(op, table, index, bytes);
+    }
+
+    inline void notify_config(name key)
+    {
+        if (chain().observer)
+            chain().observer->on_config(key);
+    }
+
+} // namespace host
+} // namespace eosio
@@ -0,0 +1,617 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/host.hpp>
+#include <eosio/name.hpp>
+
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+// modify keeps the payer of the row, as in the cdt
+static constexpr name same_payer {};
+
+template <name::raw IndexName, typename Extractor>
+struct indexed_by {
+    enum constants { index_name = static_cast<uint64_t>(IndexName) };
+    typedef Extractor secondary_extractor_type;
+};
+
+template <class Class, class Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+    typedef typename std::remove_cv<typename std::remove_reference<Type>::type>::type result_type;
+
+    template <typename ChainedPtr>
+    auto operator()(const ChainedPtr& x) const -> std::enable_if_t<!std::is_convertible<const ChainedPtr&, const Class&>::value, Type>
+    {
+        return operator()(*x);
+    }
+
+    Type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+};
+
+/**
+ * Host implementation of eosio::multi_index.
+ *
+ * Rows are stored serialized in host::store exactly like the chain database,
+ * so reading a table with a different row layout behaves as it would on
+ * nodeos. Like the cdt version, every instance keeps its own cache of loaded
+ * rows: two instances of the same table do not see each other's cached objects.
+ */
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index {
+private:
+    static_assert(sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices");
+
+    static constexpr uint64_t table_name = static_cast<uint64_t>(TableName);
+    static constexpr uint64_t unset_next_primary_key = static_cast<uint64_t>(-2);
+    static constexpr uint64_t no_available_primary_key = static_cast<uint64_t>(-2);
+
+    using key_tuple = std::tuple<typename Indices::secondary_extractor_type::result_type...>;
+
+    struct item {
+        T value;
+        uint64_t primary = 0;
+        bool deleted = false;
+    };
+
+    name _code;
+    uint64_t _scope;
+    mutable uint64_t _next_primary_key;
+    mutable std::vector<std::unique_ptr<item>> _items;
+
+    static constexpr uint64_t index_table(uint64_t number) { return (table_name & 0xFFFFFFFFFFFFFFF0ULL) | number; }
+
+    host::table_id primary_id() const { return { _code.value, _scope, table_name }; }
+
+    host::table_id secondary_id(uint64_t number) const { return { _code.value, _scope, index_table(number) }; }
+
+    template <size_t N>
+    using index_key_t = std::tuple_element_t<N, key_tuple>;
+
+    template <size_t N>
+    using index_extractor_t = typename std::tuple_element_t<N, std::tuple<Indices...>>::secondary_extractor_type;
+
+    template <size_t N>
+    host::secondary_table<index_key_t<N>>& secondary() const
+    {
+        return host::secondary_store<index_key_t<N>>::get(secondary_id(N));
+    }
+
+    const item* find_cached(uint64_t primary) const
+    {
+        for (auto it = _items.rbegin(); it != _items.rend(); ++it) {
+            if (!(*it)->deleted && (*it)->primary == primary)
+                return it->get();
+        }
+        return nullptr;
+    }
+
+    item* find_item(const T& obj) const
+    {
+        for (auto& i : _items) {
+            if (&i->value == &obj) {
+                check(!i->deleted, "object passed to modify/erase has been erased");
+                return i.get();
+            }
+        }
+        check(false, "object passed to modify/erase is not in multi_index");
+        return nullptr;
+    }
+
+    const item* load(uint64_t primary) const
+    {
+        if (auto cached = find_cached(primary))
+            return cached;
+        auto* table = host::primary_store::find(primary_id());
+        check(table != nullptr, "unable to find key");
+        auto row = table->find(primary);
+        check(row != table->end(), "unable to find key");
+        host::notify_db("get", table_name, 0, row->second.data.size());
+
+        auto i = std::make_unique<item>();
+        datastream<const char*> ds(row->second.data.data(), row->second.data.size());
+        ds >> i->value;
+        i->primary = primary;
+        _items.push_back(std::move(i));
+        return _items.back().get();
+    }
+
+    host::primary_table* table() const { return host::primary_store::find(primary_id()); }
+
+    template <size_t... N>
+    void store_secondaries(const T& obj, uint64_t primary, std::index_sequence<N...>) const
+    {
+        ((store_secondary<N>(obj, primary)), ...);
+    }
+
+    template <size_t N>
+    void store_secondary(const T& obj, uint64_t primary) const
+    {
+        auto key = index_extractor_t<N> {}(obj);
+        auto& sec = secondary<N>();
+        sec.entries.insert({ key, primary });
+        sec.keys[primary] = key;
+        host::notify_db("idx_store", table_name, N + 1, sizeof(key));
+    }
+
+    template <size_t... N>
+    void update_secondaries(const T& obj, uint64_t primary, std::index_sequence<N...>) const
+    {
+        ((update_secondary<N>(obj, primary)), ...);
+    }
+
+    template <size_t N>
+    void update_secondary(const T& obj, uint64_t primary) const
+    {
+        auto key = index_extractor_t<N> {}(obj);
+        auto& sec = secondary<N>();
+        auto old = sec.keys.find(primary);
+        check(old != sec.keys.end(), "secondary index out of sync with primary table");
+        if (old->second == key)
+            return;
+        sec.entries.erase({ old->second, primary });
+        sec.entries.insert({ key, primary });
+        old->second = key;
+        host::notify_db("idx_update", table_name, N + 1, sizeof(key));
+    }
+
+    template <size_t... N>
+    void remove_secondaries(uint64_t primary, std::index_sequence<N...>) const
+    {
+        ((remove_secondary<N>(primary)), ...);
+    }
+
+    template <size_t N>
+    void remove_secondary(uint64_t primary) const
+    {
+        auto& sec = secondary<N>();
+        auto old = sec.keys.find(primary);
+        if (old == sec.keys.end())
+            return;
+        sec.entries.erase({ old->second, primary });
+        sec.keys.erase(old);
+        host::notify_db("idx_remove", table_name, N + 1, 0);
+    }
+
+    template <uint64_t IndexName, size_t N = 0>
+    static constexpr size_t index_number()
+    {
+        static_assert(N < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+        if constexpr (static_cast<uint64_t>(std::tuple_element_t<N, std::tuple<Indices...>>::index_name) == IndexName)
+            return N;
+        else
+            return index_number<IndexName, N + 1>();
+    }
+
+public:
+    struct const_iterator {
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = const T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() { }
+
+        const T& operator*() const
+        {
+            check(_item != nullptr, "cannot dereference end iterator");
+            return _item->value;
+        }
+        const T* operator->() const { return &operator*(); }
+
+        const_iterator operator++(int)
+        {
+            const_iterator result(*this);
+            ++(*this);
+            return result;
+        }
+        const_iterator operator--(int)
+        {
+            const_iterator result(*this);
+            --(*this);
+            return result;
+        }
+
+        const_iterator& operator++()
+        {
+            check(_item != nullptr, "cannot increment end iterator");
+            host::notify_db("next", table_name, 0, 0);
+            auto* t = _multidx->table();
+            auto next = t ? t->upper_bound(_item->primary) : host::primary_table::iterator();
+            _item = (t && next != t->end()) ? _multidx->load(next->first) : nullptr;
+            return *this;
+        }
+
+        const_iterator& operator--()
+        {
+            host::notify_db("previous", table_name, 0, 0);
+            auto* t = _multidx->table();
+            check(t != nullptr && !t->empty(), "cannot decrement iterator at beginning of table");
+            auto it = _item ? t->lower_bound(_item->primary) : t->end();
+            check(it != t->begin(), "cannot decrement iterator at beginning of table");
+            --it;
+            _item = _multidx->load(it->first);
+            return *this;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+    private:
+        friend class multi_index;
+        const_iterator(const multi_index* mi, const item* i = nullptr)
+            : _multidx(mi)
+            , _item(i)
+        {
+        }
+
+        const multi_index* _multidx = nullptr;
+        const item* _item = nullptr;
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    template <uint64_t IndexName, size_t Number>
+    class index {
+    public:
+        typedef index_extractor_t<Number> secondary_extractor_type;
+        typedef index_key_t<Number> secondary_key_type;
+
+        static constexpr uint64_t index_name = IndexName;
+        static constexpr uint64_t number() { return Number; }
+
+        struct const_iterator {
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = const T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            const_iterator() { }
+
+            const T& operator*() const
+            {
+                check(_item != nullptr, "cannot dereference end iterator");
+                return _item->value;
+            }
+            const T* operator->() const { return &operator*(); }
+
+            const_iterator operator++(int)
+            {
+                const_iterator result(*this);
+                ++(*this);
+                return result;
+            }
+            const_iterator operator--(int)
+            {
+                const_iterator result(*this);
+                --(*this);
+                return result;
+            }
+
+            const_iterator& operator++()
+            {
+                check(_item != nullptr, "cannot increment end iterator");
+                host::notify_db("idx_next", table_name, Number + 1, 0);
+                auto& sec = _idx->_multidx->template secondary<Number>();
+                auto key = sec.keys.find(_item->primary);
+                check(key != sec.keys.end(), "secondary index out of sync with primary table");
+                auto next = sec.entries.upper_bound({ key->second, _item->primary });
+                _item = next != sec.entries.end() ? _idx->_multidx->load(next->second) : nullptr;
+                return *this;
+            }
+
+            const_iterator& operator--()
+            {
+                host::notify_db("idx_previous", table_name, Number + 1, 0);
+                auto& sec = _idx->_multidx->template secondary<Number>();
+                auto it = sec.entries.end();
+                if (_item) {
+                    auto key = sec.keys.find(_item->primary);
+                    check(key != sec.keys.end(), "secondary index out of sync with primary table");
+                    it = sec.entries.lower_bound({ key->second, _item->primary });
+                }
+                check(it != sec.entries.begin(), "cannot decrement iterator at beginning of index");
+                --it;
+                _item = _idx->_multidx->load(it->second);
+                return *this;
+            }
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+        private:
+            friend class index;
+            const_iterator(const index* idx, const item* i = nullptr)
+                : _idx(idx)
+                , _item(i)
+            {
+            }
+
+            const index* _idx = nullptr;
+            const item* _item = nullptr;
+        };
+
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        const_iterator cbegin() const
+        {
+            host::notify_db("idx_lowerbound", table_name, Number + 1, 0);
+            auto& sec = _multidx->template secondary<Number>();
+            if (sec.entries.empty())
+                return cend();
+            return const_iterator(this, _multidx->load(sec.entries.begin()->second));
+        }
+        const_iterator begin() const { return cbegin(); }
+        const_iterator cend() const { return const_iterator(this); }
+        const_iterator end() const { return cend(); }
+        const_reverse_iterator crbegin() const { return std::make_reverse_iterator(cend()); }
+        const_reverse_iterator rbegin() const { return crbegin(); }
+        const_reverse_iterator crend() const { return std::make_reverse_iterator(cbegin()); }
+        const_reverse_iterator rend() const { return crend(); }
+
+        const_iterator lower_bound(const secondary_key_type& secondary) const
+        {
+            host::notify_db("idx_lowerbound", table_name, Number + 1, 0);
+            auto& sec = _multidx->template secondary<Number>();
+            auto it = sec.entries.lower_bound({ secondary, 0 });
+            if (it == sec.entries.end())
+                return cend();
+            return const_iterator(this, _multidx->load(it->second));
+        }
+
+        const_iterator upper_bound(const secondary_key_type& secondary) const
+        {
+            host::notify_db("idx_upperbound", table_name, Number + 1, 0);
+            auto& sec = _multidx->template secondary<Number>();
+            auto it = sec.entries.lower_bound({ secondary, std::numeric_limits<uint64_t>::max() });
+            while (it != sec.entries.end() && !(secondary < it->first))
+                ++it;
+            if (it == sec.entries.end())
+                return cend();
+            return const_iterator(this, _multidx->load(it->second));
+        }
+
+        const_iterator find(const secondary_key_type& secondary) const
+        {
+            auto lb = lower_bound(secondary);
+            auto e = cend();
+            if (lb == e)
+                return e;
+            if (secondary != secondary_extractor_type {}(*lb))
+                return e;
+            return lb;
+        }
+
+        const_iterator require_find(const secondary_key_type& secondary, const char* error_msg = "unable to find secondary key") const
+        {
+            auto itr = find(secondary);
+            check(itr != cend(), error_msg);
+            return itr;
+        }
+
+        const T& get(const secondary_key_type& secondary, const char* error_msg = "unable to find secondary key") const
+        {
+            auto result = find(secondary);
+            check(result != cend(), error_msg);
+            return *result;
+        }
+
+        const_iterator iterator_to(const T& obj) const { return const_iterator(this, _multidx->find_item(obj)); }
+
+        template <typename Lambda>
+        void modify(const_iterator itr, name payer, Lambda&& updater)
+        {
+            check(itr != cend(), "cannot pass end iterator to modify");
+            _multidx->modify(*itr, payer, std::forward<Lambda&&>(updater));
+        }
+
+        const_iterator erase(const_iterator itr)
+        {
+            check(itr != cend(), "cannot pass end iterator to erase");
+            const auto& obj = *itr;
+            ++itr;
+            _multidx->erase(obj);
+            return itr;
+        }
+
+        eosio::name get_code() const { return _multidx->get_code(); }
+        uint64_t get_scope() const { return _multidx->get_scope(); }
+
+    private:
+        friend class multi_index;
+
+        index(typename std::conditional<std::is_const<T>::value, const multi_index*, multi_index*>::type midx)
+            : _multidx(midx)
+        {
+        }
+
+        multi_index* _multidx;
+    };
+
+    multi_index(name code, uint64_t scope)
+        : _code(code)
+        , _scope(scope)
+        , _next_primary_key(unset_next_primary_key)
+    {
+    }
+
+    multi_index(const multi_index&) = delete;
+    multi_index& operator=(const multi_index&) = delete;
+
+    name get_code() const { return _code; }
+    uint64_t get_scope() const { return _scope; }
+
+    const_iterator cbegin() const { return lower_bound(std::numeric_limits<uint64_t>::lowest()); }
+    const_iterator begin() const { return cbegin(); }
+    const_iterator cend() const { return const_iterator(this); }
+    const_iterator end() const { return cend(); }
+    const_reverse_iterator crbegin() const { return std::make_reverse_iterator(cend()); }
+    const_reverse_iterator rbegin() const { return crbegin(); }
+    const_reverse_iterator crend() const { return std::make_reverse_iterator(cbegin()); }
+    const_reverse_iterator rend() const { return crend(); }
+
+    const_iterator lower_bound(uint64_t primary) const
+    {
+        host::notify_db("lowerbound", table_name, 0, 0);
+        auto* t = table();
+        if (!t)
+            return end();
+        auto it = t->lower_bound(primary);
+        if (it == t->end())
+            return end();
+        return const_iterator(this, load(it->first));
+    }
+
+    const_iterator upper_bound(uint64_t primary) const
+    {
+        host::notify_db("upperbound", table_name, 0, 0);
+        auto* t = table();
+        if (!t)
+            return end();
+        auto it = t->upper_bound(primary);
+        if (it == t->end())
+            return end();
+        return const_iterator(this, load(it->first));
+    }
+
+    uint64_t available_primary_key() const
+    {
+        if (_next_primary_key == unset_next_primary_key) {
+            auto* t = table();
+            if (!t || t->empty()) {
+                _next_primary_key = 0;
+            } else {
+                auto last = t->rbegin()->first;
+                _next_primary_key = last >= no_available_primary_key ? no_available_primary_key : last + 1;
+            }
+        }
+        check(_next_primary_key < no_available_primary_key, "next primary key in table is at autoincrement limit");
+        return _next_primary_key;
+    }
+
+    template <name::raw IndexName>
+    auto get_index()
+    {
+        constexpr size_t n = index_number<static_cast<uint64_t>(IndexName)>();
+        return index<static_cast<uint64_t>(IndexName), n>(this);
+    }
+
+    template <name::raw IndexName>
+    auto get_index() const
+    {
+        constexpr size_t n = index_number<static_cast<uint64_t>(IndexName)>();
+        return index<static_cast<uint64_t>(IndexName), n>(const_cast<multi_index*>(this));
+    }
+
+    const_iterator iterator_to(const T& obj) const { return const_iterator(this, find_item(obj)); }
+
+    template <typename Lambda>
+    const_iterator emplace(name payer, Lambda&& constructor)
+    {
+        check(_code.value != 0, "cannot create objects in table of another contract");
+
+        auto i = std::make_unique<item>();
+        constructor(i->value);
+        i->primary = i->value.primary_key();
+
+        auto& t = host::primary_store::get(primary_id());
+        check(t.find(i->primary) == t.end(), "could not insert object, most likely a uniqueness constraint was violated");
+        auto data = pack(i->value);
+        host::notify_db("store", table_name, 0, data.size());
+        t[i->primary] = host::row { payer, std::move(data) };
+        store_secondaries(i->value, i->primary, std::index_sequence_for<Indices...> {});
+
+        if (i->primary >= _next_primary_key || _next_primary_key == unset_next_primary_key)
+            _next_primary_key = (i->primary >= no_available_primary_key) ? no_available_primary_key : (i->primary + 1);
+
+        _items.push_back(std::move(i));
+        return const_iterator(this, _items.back().get());
+    }
+
+    template <typename Lambda>
+    void modify(const_iterator itr, name payer, Lambda&& updater)
+    {
+        check(itr != end(), "cannot pass end iterator to modify");
+        modify(*itr, payer, std::forward<Lambda&&>(updater));
+    }
+
+    template <typename Lambda>
+    void modify(const T& obj, name payer, Lambda&& updater)
+    {
+        auto* i = find_item(obj);
+        auto pk = i->primary;
+
+        auto& mutable_obj = const_cast<T&>(obj);
+        updater(mutable_obj);
+        check(pk == obj.primary_key(), "updater cannot change primary key when modifying an object");
+
+        auto& t = host::primary_store::get(primary_id());
+        auto row = t.find(pk);
+        check(row != t.end(), "object passed to modify has been removed from the table");
+        auto data = pack(obj);
+        host::notify_db("update", table_name, 0, data.size());
+        row->second.data = std::move(data);
+        if (payer.value)
+            row->second.payer = payer;
+        update_secondaries(obj, pk, std::index_sequence_for<Indices...> {});
+    }
+
+    const T& get(uint64_t primary, const char* error_msg = "unable to find key") const
+    {
+        auto result = find(primary);
+        check(result != cend(), error_msg);
+        return *result;
+    }
+
+    const_iterator find(uint64_t primary) const
+    {
+        if (auto cached = find_cached(primary))
+            return const_iterator(this, cached);
+        host::notify_db("find", table_name, 0, 0);
+        auto* t = table();
+        if (!t || t->find(primary) == t->end())
+            return end();
+        return const_iterator(this, load(primary));
+    }
+
+    const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const
+    {
+        auto itr = find(primary);
+        check(itr != end(), error_msg);
+        return itr;
+    }
+
+    const_iterator erase(const_iterator itr)
+    {
+        check(itr != end(), "cannot pass end iterator to erase");
+        const auto& obj = *itr;
+        ++itr;
+        erase(obj);
+        return itr;
+    }
+
+    void erase(const T& obj)
+    {
+        auto* i = find_item(obj);
+        auto& t = host::primary_store::get(primary_id());
+        host::notify_db("remove", table_name, 0, 0);
+        t.erase(i->primary);
+        remove_secondaries(i->primary, std::index_sequence_for<Indices...> {});
+        i->deleted = true;
+    }
+};
+
+} // namespace eosio
@@ -0,0 +1,31 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+namespace eosio {
+
+inline void print() { }
+
+template <typename Arg, typename... Args>
+void print(Arg&& a, Args&&... args)
+{
+    using T = std::decay_t<Arg>;
+    if constexpr (std::is_same_v<T, name> || std::is_same_v<T, asset> || std::is_same_v<T, symbol>)
+        std::cout << a.to_string();
+    else if constexpr (std::is_same_v<T, bool>)
+        std::cout << (a ? "true" : "false");
+    else
+        std::cout << a;
+    print(std::forward<Args>(args)...);
+}
+
+} // namespace eosio
@@ -0,0 +1,55 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/host.hpp>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace eosio {
+namespace host {
+
+    /**
+     * Counts what every pushed action costs: database operations per table,
+     * index and operation with the bytes they move, inline actions per name
+     * and, in a DMC_PROFILE build, get_dmc_config calls per key. Inline
+     * actions run by an action are charged to it.
+     *
+     * One JSON line per action is written to ${out} when it ends, e.g.
+     *   {"action":"dmc.token::claimorder","failed":false,"db_ops":9,"bytes_written":356,
+     *    "db":[{"table":"dmcorderv2","index":0,"op":"find","count":1,"bytes":0},...],
+     *    "inline":[{"action":"dmc.token::batchrec","count":1,"bytes":412}],
+     *    "config":[{"key":"legacyrec","count":4}]}
+     * index 0 is the primary key, n the n-th secondary index. Entries are
+     * sorted so that the output of two releases can be diffed.
+     */
+    class profiler : public db_observer {
+    public:
+        explicit profiler(std::ostream& out);
+        ~profiler();
+
+        void on_action(const action& act) override;
+        void on_action_end(const action& act, bool failed) override;
+        void on_db(const char* op, uint64_t table, uint64_t index, size_t bytes) override;
+        void on_inline(name account, name act, size_t bytes) override;
+        void on_config(name key) override;
+
+    private:
+        struct cost {
+            uint64_t count = 0;
+            uint64_t bytes = 0;
+        };
+
+        std::ostream& _out;
+        std::map<std::tuple<uint64_t, uint64_t, std::string>, cost> _db;
+        std::map<std::pair<uint64_t, uint64_t>, cost> _inline;
+        std::map<uint64_t, uint64_t> _config;
+    };
+
+} // namespace host
+} // namespace eosio
@@ -0,0 +1,187 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace eosio { namespace reflect {
+
+/**
+ * Field visitation for aggregates that do not spell out EOSLIB_SERIALIZE.
+ * The cdt gets this from boost::pfr; the host build counts the fields with
+ * brace initialization and visits them through structured bindings.
+ */
+struct any_field {
+    template <typename T>
+    constexpr operator T() const noexcept;
+};
+
+template <typename T, typename = void, size_t... I>
+struct is_brace_constructible_impl : std::false_type { };
+
+template <typename T, size_t... I>
+struct is_brace_constructible_impl<T, std::void_t<decltype(T { (void(I), any_field {})... })>, I...> : std::true_type { };
+
+template <typename T, size_t... I>
+constexpr bool is_brace_constructible(std::index_sequence<I...>)
+{
+    return is_brace_constructible_impl<T, void, I...>::value;
+}
+
+template <typename T, size_t N = 0>
+constexpr size_t field_count()
+{
+    if constexpr (N > 32) {
+        return N;
+    } else if constexpr (is_brace_constructible<T>(std::make_index_sequence<N + 1> {})) {
+        return field_count<T, N + 1>();
+    } else {
+        return N;
+    }
+}
+
+template <typename T>
+inline constexpr bool is_reflectable_v = std::is_aggregate_v<std::decay_t<T>> && !std::is_array_v<std::decay_t<T>>;
+
+template <typename T, typename F>
+void for_each_field(T&& v, F&& f)
+{
+    constexpr size_t n = field_count<std::decay_t<T>>();
+    static_assert(n <= 32, "too many fields to reflect");
+    if constexpr (n == 0) {
+    }
+    else if constexpr (n == 1) {
+        auto&& [f0] = v;
+        f(f0);
+    }
+    else if constexpr (n == 2) {
+        auto&& [f0, f1] = v;
+        f(f0); f(f1);
+    }
+    else if constexpr (n == 3) {
+        auto&& [f0, f1, f2] = v;
+        f(f0); f(f1); f(f2);
+    }
+    else if constexpr (n == 4) {
+        auto&& [f0, f1, f2, f3] = v;
+        f(f0); f(f1); f(f2); f(f3);
+    }
+    else if constexpr (n == 5) {
+        auto&& [f0, f1, f2, f3, f4] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4);
+    }
+    else if constexpr (n == 6) {
+        auto&& [f0, f1, f2, f3, f4, f5] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5);
+    }
+    else if constexpr (n == 7) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6);
+    }
+    else if constexpr (n == 8) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7);
+    }
+    else if constexpr (n == 9) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8);
+    }
+    else if constexpr (n == 10) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9);
+    }
+    else if constexpr (n == 11) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10);
+    }
+    else if constexpr (n == 12) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11);
+    }
+    else if constexpr (n == 13) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12);
+    }
+    else if constexpr (n == 14) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13);
+    }
+    else if constexpr (n == 15) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14);
+    }
+    else if constexpr (n == 16) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15);
+    }
+    else if constexpr (n == 17) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16);
+    }
+    else if constexpr (n == 18) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17);
+    }
+    else if constexpr (n == 19) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18);
+    }
+    else if constexpr (n == 20) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19);
+    }
+    else if constexpr (n == 21) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20);
+    }
+    else if constexpr (n == 22) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21);
+    }
+    else if constexpr (n == 23) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22);
+    }
+    else if constexpr (n == 24) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23);
+    }
+    else if constexpr (n == 25) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24);
+    }
+    else if constexpr (n == 26) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25);
+    }
+    else if constexpr (n == 27) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26);
+    }
+    else if constexpr (n == 28) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26); f(f27);
+    }
+    else if constexpr (n == 29) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26); f(f27); f(f28);
+    }
+    else if constexpr (n == 30) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26); f(f27); f(f28); f(f29);
+    }
+    else if constexpr (n == 31) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26); f(f27); f(f28); f(f29); f(f30);
+    }
+    else if constexpr (n == 32) {
+        auto&& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31] = v;
+        f(f0); f(f1); f(f2); f(f3); f(f4); f(f5); f(f6); f(f7); f(f8); f(f9); f(f10); f(f11); f(f12); f(f13); f(f14); f(f15); f(f16); f(f17); f(f18); f(f19); f(f20); f(f21); f(f22); f(f23); f(f24); f(f25); f(f26); f(f27); f(f28); f(f29); f(f30); f(f31);
+    }
+}
+
+} } // namespace eosio::reflect
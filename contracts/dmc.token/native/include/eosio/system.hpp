@@ -0,0 +1,15 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/host.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+inline time_point current_time_point() { return host::chain().now; }
+
+} // namespace eosio
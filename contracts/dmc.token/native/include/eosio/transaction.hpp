@@ -0,0 +1,16 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/host.hpp>
+
+namespace eosio {
+
+inline int tapos_block_num() { return int(host::chain().tapos_num); }
+
+inline int tapos_block_prefix() { return int(host::chain().tapos_prefix); }
+
+} // namespace eosio
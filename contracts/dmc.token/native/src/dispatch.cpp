@@ -0,0 +1,35 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#include <dmc.token/dmc.token.hpp>
+#include <eosio/host.hpp>
+
+namespace eosio {
+namespace host {
+
+    void bind_token(name account)
+    {
+#define BIND(act) bind(account, #act##_n, &token::act)
+        BIND(create); BIND(issue); BIND(retire); BIND(transfer); BIND(close); BIND(excreate);
+        BIND(exissue); BIND(exretire); BIND(extransfer); BIND(exclose); BIND(exroute);
+        BIND(exdestroy); BIND(exlocktrans); BIND(exunlock); BIND(exlock); BIND(bill); BIND(unbill);
+        BIND(getincentive); BIND(setabostats); BIND(order); BIND(bestorder); BIND(multiorder);
+        BIND(syncbills); BIND(migrateorder); BIND(migratebill); BIND(setreserve); BIND(allocation);
+        BIND(increase); BIND(redemption); BIND(mint); BIND(setmakerrate); BIND(setmakerbstr);
+        BIND(liquidation); BIND(addmerkle); BIND(reqchallenge); BIND(anschallenge);
+        BIND(arbitration); BIND(paychallenge); BIND(setdmcconfig); BIND(adjustprice);
+        BIND(claimorder); BIND(claimorders); BIND(claimdeposit); BIND(addordasset);
+        BIND(subordasset); BIND(updateorder); BIND(settleorders); BIND(cancelorder);
+        BIND(nftcreatesym); BIND(nftcreate); BIND(nftissue); BIND(nfttransfer); BIND(nfttransferb);
+        BIND(nftburn); BIND(burnbatch); BIND(batchrec); BIND(outreceipt); BIND(traderecord);
+        BIND(pricerec); BIND(uniswapsnap); BIND(incentiverec); BIND(redeemrec); BIND(liqrec);
+        BIND(billliqrec); BIND(currliqrec); BIND(nftsymrec); BIND(nftrec); BIND(nftaccrec);
+        BIND(allocrec); BIND(innerswaprec); BIND(orderrec); BIND(challengerec); BIND(orderdelta);
+        BIND(chaldelta); BIND(billsnap); BIND(makerecord); BIND(makerpoolrec); BIND(makersnaprec);
+        BIND(lpsnaprec); BIND(ordsnaprec); BIND(dismakerec); BIND(assetrec); BIND(orderassrec);
+#undef BIND
+    }
+
+} // namespace host
+} // namespace eosio
@@ -0,0 +1,127 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#include <eosio/action.hpp>
+#include <eosio/host.hpp>
+
+#include <deque>
+
+namespace eosio {
+namespace host {
+
+    namespace {
+        std::deque<action>& pending()
+        {
+            static std::deque<action> queue;
+            return queue;
+        }
+
+        void run(const action& act)
+        {
+            auto& c = chain();
+            auto saved_auths = c.auths;
+            c.auths.clear();
+            for (auto& p : act.authorization)
+                c.auths.push_back(p.actor);
+
+            // inline actions sent by this action run after it returns, in order
+            std::deque<action> outer;
+            std::swap(outer, pending());
+
+            auto it = handlers().find({ act.account.value, act.name.value });
+            if (it != handlers().end())
+                it->second(act);
+
+            std::deque<action> inner;
+            std::swap(inner, pending());
+            std::swap(outer, pending());
+            c.auths = saved_auths;
+
+            for (auto& a : inner) {
+                if (c.observer)
+                    c.observer->on_inline(a.account, a.name, a.data.size());
+                if (c.execute_inline)
+                    run(a);
+            }
+        }
+    }
+
+    std::vector<store_hooks>& stores()
+    {
+        static std::vector<store_hooks> s;
+        return s;
+    }
+
+    state& chain()
+    {
+        static state s;
+        return s;
+    }
+
+    std::map<std::pair<uint64_t, uint64_t>, handler>& handlers()
+    {
+        static std::map<std::pair<uint64_t, uint64_t>, handler> h;
+        return h;
+    }
+
+    void push_action(const action& act)
+    {
+        std::vector<std::any> snapshot;
+        if (chain().rollback) {
+            for (auto& s : stores())
+                snapshot.push_back(s.save());
+        }
+        auto sent = chain().sent.size();
+        auto observer = chain().observer;
+        if (observer)
+            observer->on_action(act);
+
+        try {
+            pending().clear();
+            run(act);
+        } catch (...) {
+            if (observer)
+                observer->on_action_end(act, true);
+            pending().clear();
+            if (chain().rollback) {
+                for (size_t i = 0; i < snapshot.size(); ++i)
+                    stores()[i].restore(snapshot[i]);
+                // stores created while the action ran did not exist before it
+                for (size_t i = snapshot.size(); i < stores().size(); ++i)
+                    stores()[i].clear();
+            }
+            chain().sent.resize(sent);
+            chain().recipients.clear();
+            throw;
+        }
+        chain().recipients.clear();
+        if (observer)
+            observer->on_action_end(act, false);
+    }
+
+    void reset()
+    {
+        for (auto& s : stores())
+            s.clear();
+        pending().clear();
+        auto observer = chain().observer;
+        auto rollback = chain().rollback;
+        chain() = state();
+        chain().observer = observer;
+        chain().rollback = rollback;
+    }
+
+    void set_time(time_point t) { chain().now = t; }
+
+    void advance(microseconds m) { chain().now += m; }
+
+} // namespace host
+
+void action::send() const
+{
+    host::chain().sent.push_back(*this);
+    host::pending().push_back(*this);
+}
+
+} // namespace eosio
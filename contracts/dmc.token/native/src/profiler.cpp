@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#include <eosio/action.hpp>
+#include <eosio/profiler.hpp>
+
+#include <cstring>
+
+namespace eosio {
+namespace host {
+
+    namespace {
+        bool is_write(const char* op)
+        {
+            return !strcmp(op, "store") || !strcmp(op, "update") || !strcmp(op, "idx_store") || !strcmp(op, "idx_update");
+        }
+
+        std::string action_name(name account, name act)
+        {
+            return account.to_string() + "::" + act.to_string();
+        }
+    } // namespace
+
+    profiler::profiler(std::ostream& out)
+        : _out(out)
+    {
+        chain().observer = this;
+    }
+
+    profiler::~profiler()
+    {
+        if (chain().observer == this)
+            chain().observer = nullptr;
+    }
+
+    void profiler::on_action(const action& act)
+    {
+        _db.clear();
+        _inline.clear();
+        _config.clear();
+    }
+
+    void profiler::on_action_end(const action& act, bool failed)
+    {
+        uint64_t ops = 0, written = 0;
+        for (auto& d : _db) {
+            ops += d.second.count;
+            if (is_write(std::get<2>(d.first).c_str()))
+                written += d.second.bytes;
+        }
+
+        _out << "{\"action\":\"" << action_name(act.account, act.name).c_str() << "\",\"failed\":" << (failed ? "true" : "false")
+             << ",\"db_ops\":" << ops << ",\"bytes_written\":" << written << ",\"db\":[";
+        const char* sep = "";
+        for (auto& d : _db) {
+            _out << sep << "{\"table\":\"" << name(std::get<0>(d.first)).to_string().c_str() << "\",\"index\":" << std::get<1>(d.first)
+                 << ",\"op\":\"" << std::get<2>(d.first).c_str() << "\",\"count\":" << d.second.count << ",\"bytes\":" << d.second.bytes << "}";
+            sep = ",";
+        }
+        _out << "],\"inline\":[";
+        sep = "";
+        for (auto& i : _inline) {
+            _out << sep << "{\"action\":\"" << action_name(name(i.first.first), name(i.first.second)).c_str() << "\",\"count\":" << i.second.count
+                 << ",\"bytes\":" << i.second.bytes << "}";
+            sep = ",";
+        }
+        _out << "],\"config\":[";
+        sep = "";
+        for (auto& c : _config) {
+            _out << sep << "{\"key\":\"" << name(c.first).to_string().c_str() << "\",\"count\":" << c.second << "}";
+            sep = ",";
+        }
+        _out << "]}" << std::endl;
+    }
+
+    void profiler::on_db(const char* op, uint64_t table, uint64_t index, size_t bytes)
+    {
+        auto& c = _db[{ table, index, op }];
+        c.count++;
+        c.bytes += bytes;
+    }
+
+    void profiler::on_inline(name account, name act, size_t bytes)
+    {
+        auto& c = _inline[{ account.value, act.value }];
+        c.count++;
+        c.bytes += bytes;
+    }
+
+    void profiler::on_config(name key) { _config[key.value]++; }
+
+} // namespace host
+} // namespace eosio
@@ -10,17 +10,12 @@ namespace eosio {
 token::token(name receiver, name code, datastream<const char*> ds)
     : contract(receiver, code, ds)
 {
-    dmc_global dmc_global_tbl(get_self(), get_self().value);
-    auto destory_iter = dmc_global_tbl.find("olderbillid"_n.value);
-    if (destory_iter == dmc_global_tbl.end()) {
-        auto current_id_iter = dmc_global_tbl.find("billid"_n.value);
-        if (current_id_iter != dmc_global_tbl.end()) {
-            dmc_global_tbl.emplace(_self, [&](auto& conf) {
-                conf.key = "olderbillid"_n;
-                conf.value = current_id_iter->value;
-            });
-        }
-    }
+}
+
+token::~token()
+{
+    flush_dmc_config();
+    flush_receipts();
 }
 
 void token::create(name issuer,
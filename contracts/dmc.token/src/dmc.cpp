@@ -5,6 +5,10 @@
 
 #include <dmc.token/dmc.token.hpp>
 
+#ifdef DMC_PROFILE
+#include <eosio/host.hpp>
+#endif
+
 namespace eosio {
 
 void token::bill(name owner, extended_asset asset, double price, time_point_sec expire_on, uint64_t deposit_ratio, string memo) {
@@ -28,8 +32,8 @@ void token::bill(name owner, extended_asset asset, double price, time_point_sec
     bill_record bill_info = {
         .bill_id = bill_id,
         .owner = owner,
-        .unmatched = asset,
         .matched = extended_asset(0, pst_sym),
+        .unmatched = asset,
         .price = price_t,
         .created_at = now_time,
         .updated_at = now_time,
@@ -40,44 +44,67 @@ void token::bill(name owner, extended_asset asset, double price, time_point_sec
     sst.emplace(owner, [&](auto& r) {
         r = bill_info;
     });
-    SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {bill_info});
+    update_bill_level(bill_id, price_t, asset.quantity.amount, owner);
+    SEND_RECEIPT(*this, billsnap, {bill_info});
 }
 
 void token::unbill(name owner, uint64_t bill_id, string memo) {
     require_auth(owner);
     check(memo.size() <= 256, "memo has more than 256 bytes");
 
-    // TODO: delete it after
-    if (bill_id < get_dmc_config("olderbillid"_n, default_id_start)) {
-        bill_stats sst(get_self(), owner.value);
-        auto ust = sst.find(bill_id);
-        check(ust != sst.end(), "no such record");
-        extended_asset unmatched_asseet = ust->unmatched;
-        calbonus(owner, bill_id, owner);
-        sst.erase(ust);
-        add_balance(owner, unmatched_asseet, owner);
-        bill_record bill_info = {
-            .bill_id = bill_id,
-            .owner = owner,
-            .unmatched = unmatched_asseet};
-
-        SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {bill_info});
-    } else {
-        bill_stats sst(get_self(), get_self().value);
-        auto ust = sst.find(bill_id);
-        check(ust != sst.end(), "no such record");
-        check(ust->owner == owner, "only owner can unbill");
-        extended_asset unmatched_asseet = ust->unmatched;
-        calbonus(owner, bill_id, owner);
-        sst.erase(ust);
-        add_balance(owner, unmatched_asseet, owner);
-        bill_record bill_info = {
-            .bill_id = bill_id,
-            .owner = owner,
-            .unmatched = unmatched_asseet};
+    bill_stats sst(get_self(), get_self().value);
+    auto ust = sst.find(bill_id);
+    if (ust == sst.end()) {
+        // bills of the old per owner scope can only be unbilled, see migratebill
+        bill_stats legacy_sst(get_self(), owner.value);
+        auto legacy_iter = legacy_sst.find(bill_id);
+        check(legacy_iter != legacy_sst.end(), "no such record");
+        close_legacy_bill(owner, legacy_sst, legacy_iter, owner);
+        return;
+    }
+    check(ust->owner == owner, "only owner can unbill");
+    // the pst of a pending liquidation is already taken, its bills and stake stay until the penalty is charged
+    liquidation_states liq_tbl(get_self(), get_self().value);
+    check(liq_tbl.find(owner.value) == liq_tbl.end(), "bills are being liquidated");
+    extended_asset unmatched_asseet = ust->unmatched;
+    calbonus(owner, *ust);
+    settle_incentive(owner, owner);
+    update_bill_level(bill_id, ust->price, 0, owner);
+    sst.erase(ust);
+    add_balance(owner, unmatched_asseet, owner);
+    bill_record bill_info = {
+        .bill_id = bill_id,
+        .owner = owner,
+        .unmatched = unmatched_asseet};
 
-        SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {bill_info});
+    SEND_RECEIPT(*this, billsnap, {bill_info});
+}
+
+void token::migratebill(name owner, uint64_t limit) {
+    require_auth(dmc_account);
+    // close ${limit} bills of the old per owner scope at a time, the owner gets the pst and the incentive back
+    bill_stats legacy_sst(get_self(), owner.value);
+    for (uint64_t count = 0; legacy_sst.begin() != legacy_sst.end() && count < limit; count++) {
+        close_legacy_bill(owner, legacy_sst, legacy_sst.begin(), get_self());
+    }
+}
+
+void token::close_legacy_bill(name owner, bill_stats& legacy_sst, bill_stats::const_iterator bill_iter, name payer) {
+    uint64_t bill_id = bill_iter->bill_id;
+    extended_asset unmatched_asseet = bill_iter->unmatched;
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    if (maker_tbl.find(owner.value) != maker_tbl.end()) {
+        calbonus(owner, *bill_iter);
+        settle_incentive(owner, payer);
     }
+    legacy_sst.erase(bill_iter);
+    add_balance(owner, unmatched_asseet, payer);
+    bill_record bill_info = {
+        .bill_id = bill_id,
+        .owner = owner,
+        .unmatched = unmatched_asseet};
+
+    SEND_RECEIPT(*this, billsnap, {bill_info});
 }
 
 void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo) {
@@ -94,6 +121,140 @@ void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceR
     double current_price = get_benchmark_price();
     check(current_price <= (double)benchmark_price / 10000.0 * 1.05 && current_price >= (double)benchmark_price / 10000.0 * 0.95, "current price is not in benchmark price range");
 
+    uint64_t lower_bound_begin = 0;
+    uint64_t upper_bound_end = 0;
+    std::tie(lower_bound_begin, upper_bound_end) = get_price_bounds(benchmark_price, price_range);
+
+    bill_stats sst(get_self(), get_self().value);
+    auto bill_iter = sst.find(bill_id);
+    check(bill_iter != sst.end() && bill_iter->price >= lower_bound_begin && bill_iter->price <= upper_bound_end && bill_iter->unmatched >= asset, "no matched bill");
+
+    // the bill must be in the first ${bill_number_limit} price levels that can fill the order
+    bill_levels level_tbl(get_self(), get_self().value);
+    uint64_t bill_number_limit = get_dmc_config("billnumlimit"_n, default_bill_num_limit);
+    uint64_t count = 0;
+    for (auto level_iter = level_tbl.lower_bound(lower_bound_begin); level_iter != level_tbl.end() && level_iter->price < bill_iter->price && count < bill_number_limit; level_iter++) {
+        if (level_iter->max_unmatched >= uint64_t(asset.quantity.amount)) {
+            count++;
+        }
+    }
+    check(count < bill_number_limit, "no matched bill");
+
+    sub_balance(owner, reserve);
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    fill_bill(owner, sst, bill_iter, epoch, asset, reserve, current_price, maker_tbl);
+}
+
+void token::bestorder(name owner, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo) {
+    require_auth(owner);
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+    check(price_range > RangeTypeBegin && price_range < RangeTypeEnd, "invalid price range");
+    check(epoch > 0, "invalid epoch");
+    check(asset.get_extended_symbol() == pst_sym, "only PST can be ordered");
+    check(asset.quantity.amount > 0, "must order a positive amount");
+    check(reserve.get_extended_symbol() == dmc_sym, "only DMC can be reserved");
+    check(reserve.quantity.amount >= 0, "reserve amount must >= 0");
+
+    double current_price = get_benchmark_price();
+    uint64_t lower_bound_begin = 0;
+    uint64_t upper_bound_end = 0;
+    std::tie(lower_bound_begin, upper_bound_end) = get_price_bounds(std::round(current_price * 10000), price_range);
+    uint64_t bill_number_limit = get_dmc_config("billnumlimit"_n, default_bill_num_limit);
+    uint64_t claims_interval = get_dmc_config("claiminter"_n, default_dmc_claims_interval);
+    auto service_end = time_point_sec(current_time_point() + eosio::seconds(claims_interval * epoch));
+
+    // the cheapest price level with a bill large enough, then the least recently updated of its bills,
+    // looking at no more than ${bill_number_limit} price levels and bills in all
+    bill_stats sst(get_self(), get_self().value);
+    bill_levels level_tbl(get_self(), get_self().value);
+    bill_matches match_tbl(get_self(), get_self().value);
+    auto match_idx = match_tbl.get_index<"byprice"_n>();
+    auto bill_iter = sst.end();
+    uint64_t scanned = 0;
+    for (auto level_iter = level_tbl.lower_bound(lower_bound_begin); level_iter != level_tbl.end() && level_iter->price <= upper_bound_end && bill_iter == sst.end() && scanned < bill_number_limit; level_iter++) {
+        scanned++;
+        if (level_iter->max_unmatched < uint64_t(asset.quantity.amount)) {
+            continue;
+        }
+        for (auto match_iter = match_idx.lower_bound(bill_match::key(level_iter->price, asset.quantity.amount)); match_iter != match_idx.end() && match_iter->price == level_iter->price && scanned < bill_number_limit; match_iter++) {
+            scanned++;
+            // a row left behind by a bill that is gone is passed over like a bill that can't be ordered
+            auto iter = sst.find(match_iter->bill_id);
+            if (iter == sst.end() || iter->owner == owner || iter->expire_on < service_end) {
+                continue;
+            }
+            if (bill_iter == sst.end() || iter->updated_at < bill_iter->updated_at) {
+                bill_iter = iter;
+            }
+        }
+    }
+    check(bill_iter != sst.end(), "no matched bill");
+
+    sub_balance(owner, reserve);
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    fill_bill(owner, sst, bill_iter, epoch, asset, reserve, current_price, maker_tbl);
+}
+
+void token::multiorder(name owner, PriceRangeType price_range, uint64_t epoch, extended_asset asset, extended_asset reserve, string memo) {
+    require_auth(owner);
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+    check(price_range > RangeTypeBegin && price_range < RangeTypeEnd, "invalid price range");
+    check(epoch > 0, "invalid epoch");
+    check(asset.get_extended_symbol() == pst_sym, "only PST can be ordered");
+    check(asset.quantity.amount > 0, "must order a positive amount");
+    check(reserve.get_extended_symbol() == dmc_sym, "only DMC can be reserved");
+    check(reserve.quantity.amount >= 0, "reserve amount must >= 0");
+
+    double current_price = get_benchmark_price();
+    uint64_t lower_bound_begin = 0;
+    uint64_t upper_bound_end = 0;
+    std::tie(lower_bound_begin, upper_bound_end) = get_price_bounds(std::round(current_price * 10000), price_range);
+    uint64_t bill_number_limit = get_dmc_config("billnumlimit"_n, default_bill_num_limit);
+    uint64_t claims_interval = get_dmc_config("claiminter"_n, default_dmc_claims_interval);
+    auto service_end = time_point_sec(current_time_point() + eosio::seconds(claims_interval * epoch));
+
+    // take the cheapest bills first, looking at no more than ${bill_number_limit} of them
+    bill_stats sst(get_self(), get_self().value);
+    auto price_idx = sst.get_index<"bylowerprice"_n>();
+    struct bill_fill {
+        uint64_t bill_id;
+        extended_asset pst;
+        extended_asset cost;
+    };
+    std::vector<bill_fill> fills;
+    extended_asset left = asset;
+    extended_asset total_cost = extended_asset(0, dmc_sym);
+    uint64_t scanned = 0;
+    for (auto bill_iter = price_idx.lower_bound(lower_bound_begin); bill_iter != price_idx.end() && bill_iter->price <= upper_bound_end && left.quantity.amount > 0 && scanned < bill_number_limit; bill_iter++, scanned++) {
+        if (bill_iter->owner == owner || bill_iter->expire_on < service_end) {
+            continue;
+        }
+        extended_asset fill = bill_iter->unmatched < left ? bill_iter->unmatched : left;
+        auto cost = get_fill_cost(*bill_iter, fill);
+        fills.push_back({bill_iter->bill_id, fill, cost.first + cost.second});
+        total_cost += cost.first + cost.second;
+        left -= fill;
+    }
+    check(left.quantity.amount == 0, "not enough bills to fill the order");
+    check(reserve >= total_cost, "reserve can't pay first time");
+
+    sub_balance(owner, reserve);
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    // every fill gets what it pays up front, the rest of reserve is pledged in proportion to the PST of each
+    // fill and the last one takes the rounding remainder
+    extended_asset surplus = reserve - total_cost;
+    extended_asset surplus_left = surplus;
+    for (size_t i = 0; i < fills.size(); i++) {
+        extended_asset fill_surplus = surplus_left;
+        if (i + 1 < fills.size()) {
+            fill_surplus.quantity.amount = uint128_t(surplus.quantity.amount) * fills[i].pst.quantity.amount / asset.quantity.amount;
+        }
+        surplus_left -= fill_surplus;
+        fill_bill(owner, sst, sst.find(fills[i].bill_id), epoch, fills[i].pst, fills[i].cost + fill_surplus, current_price, maker_tbl);
+    }
+}
+
+std::pair<uint64_t, uint64_t> token::get_price_bounds(uint64_t benchmark_price, PriceRangeType price_range) {
     uint64_t range = 0;
     switch (price_range) {
         case TwentyPercent:
@@ -110,36 +271,22 @@ void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceR
     }
     uint64_t lower_bound_begin = benchmark_price * (100 - range) / 100;
     uint64_t upper_bound_end = range == 100 ? uint64_max : benchmark_price * (100 + range) / 100;
+    return std::make_pair(lower_bound_begin, upper_bound_end);
+}
 
-    bill_stats sst(get_self(), get_self().value);
-    auto price_idx = sst.get_index<"bylowerprice"_n>();
-    auto lower_bound_iter = price_idx.lower_bound(lower_bound_begin);
-    bool is_match = false;
-    uint64_t bill_number_limit = get_dmc_config("billnumlimit"_n, default_bill_num_limit);
+std::pair<extended_asset, extended_asset> token::get_fill_cost(const bill_record& bill, extended_asset asset) {
+    double price = (double)bill.price / 10000;
+    double dmc_amount = price * asset.quantity.amount;
+    extended_asset user_to_pay = get_asset_by_amount<double, std::round>(dmc_amount, dmc_sym);
 
-    // search ${bill_number_limit} records,
-    // NOTE: the actual situation may be more than ${bill_number_limit} entries, as entries with the same price count as one.
-    auto start_price = lower_bound_iter->price;
-    for (uint64_t count = 0; lower_bound_iter != price_idx.end() && count < bill_number_limit; lower_bound_iter++) {
-        if (lower_bound_iter->unmatched < asset) {
-            continue;
-        }
-        if (lower_bound_iter->price > upper_bound_end) {
-            break;
-        }
-        // only count the first record with the same price
-        if (lower_bound_iter->price != start_price) {
-            count++;
-            start_price = lower_bound_iter->price;
-        }
-        if (lower_bound_iter->bill_id == bill_id) {
-            is_match = true;
-            break;
-        }
-    }
-    check(is_match, "no matched bill");
+    // deposit
+    extended_asset user_to_deposit = extended_asset(std::floor(user_to_pay.quantity.amount * bill.deposit_ratio), dmc_sym);
+    return std::make_pair(user_to_pay, user_to_deposit);
+}
 
-    name miner = lower_bound_iter->owner;
+void token::fill_bill(name owner, bill_stats& sst, bill_stats::const_iterator bill_iter, uint64_t epoch, extended_asset asset, extended_asset reserve, double current_price, dmc_makers& maker_tbl) {
+    uint64_t bill_id = bill_iter->bill_id;
+    name miner = bill_iter->owner;
     check(miner != owner, "can not order with self");
     require_recipient(miner);
     require_recipient(owner);
@@ -147,38 +294,36 @@ void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceR
     uint64_t order_serivce_epoch = get_dmc_config("ordsrvepoch"_n, default_order_service_epoch);
     uint64_t claims_interval = get_dmc_config("claiminter"_n, default_dmc_claims_interval);
 
-    check(time_point_sec(current_time_point() + eosio::seconds(claims_interval * epoch)) <= lower_bound_iter->expire_on, "service has expired");
+    check(time_point_sec(current_time_point() + eosio::seconds(claims_interval * epoch)) <= bill_iter->expire_on, "service has expired");
     check((claims_interval * epoch) >= order_serivce_epoch, "service not reach minimum deposit expire time");
 
-    double price = (double)lower_bound_iter->price / 10000;
-    double dmc_amount = price * asset.quantity.amount;
-    extended_asset user_to_pay = get_asset_by_amount<double, std::round>(dmc_amount, dmc_sym);
-
-    // deposit
-    extended_asset user_to_deposit = extended_asset(std::floor(user_to_pay.quantity.amount * lower_bound_iter->deposit_ratio), dmc_sym);
+    double price = (double)bill_iter->price / 10000;
+    extended_asset user_to_pay, user_to_deposit;
+    std::tie(user_to_pay, user_to_deposit) = get_fill_cost(*bill_iter, asset);
     check(reserve >= user_to_pay + user_to_deposit, "reserve can't pay first time");
-    sub_balance(owner, reserve);
 
-    uint64_t now_time_t = calbonus(miner, bill_id, owner);
+    uint64_t now_time_t = calbonus(miner, *bill_iter);
+    settle_incentive(miner, owner);
 
-    price_idx.modify(lower_bound_iter, get_self(), [&](auto& s) {
+    sst.modify(bill_iter, get_self(), [&](auto& s) {
         s.unmatched -= asset;
         s.matched += asset;
         s.updated_at = time_point_sec(now_time_t);
     });
+    bill_record bill_info = *bill_iter;
+    update_bill_level(bill_id, bill_info.price, bill_info.unmatched.quantity.amount, get_self());
 
-    if (lower_bound_iter->unmatched.quantity.amount == 0) {
-        price_idx.erase(lower_bound_iter);
+    if (bill_info.unmatched.quantity.amount == 0) {
+        sst.erase(bill_iter);
     }
 
     uint64_t order_id = get_dmc_config("orderid"_n, default_id_start);
 
-    dmc_makers maker_tbl(get_self(), get_self().value);
     auto maker_iter = maker_tbl.find(miner.value);
     check(maker_iter != maker_tbl.end(), "can't find maker pool");
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    uint64_t r = std::floor(maker_iter->current_rate * 100.0 / get_benchmark_price());
+    uint64_t r = std::floor(maker_iter->current_rate * 100.0 / current_price);
     // r = 5m' if r > 5m'
     if (r > maker_iter->benchmark_stake_rate * 5) {
         r = maker_iter->benchmark_stake_rate * 5;
@@ -194,9 +339,9 @@ void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceR
         .user_pledge = reserve - user_to_pay - user_to_deposit,
         .miner_lock_pst = asset,
         .miner_lock_dmc = miner_lock_dmc,
+        .price = user_to_pay,
         .settlement_pledge = extended_asset(0, user_to_pay.get_extended_symbol()),
         .lock_pledge = user_to_pay,
-        .price = user_to_pay,
         .state = OrderStateWaiting,
         .deliver_start_date = time_point_sec(),
         .latest_settlement_date = time_point_sec(),
@@ -236,11 +381,100 @@ void token::order(name owner, uint64_t bill_id, uint64_t benchmark_price, PriceR
     generate_maker_snapshot(order_info.order_id, bill_id, order_info.miner, owner, r, maker_iter->total_staked.quantity.amount == 0);
     trace_price_history(price, bill_id, order_info.order_id);
     set_dmc_config("orderid"_n, order_id + 1);
-    SEND_INLINE_ACTION(*this, orderrec, {_self, "active"_n}, {order_info, 1});
-    SEND_INLINE_ACTION(*this, challengerec, {_self, "active"_n}, {challenge_info});
-    SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {*lower_bound_iter});
-    SEND_INLINE_ACTION(*this, assetrec, {_self, "active"_n}, {order_info.order_id, {reserve}, order_info.user, AssetReceiptAddReserve});
-    SEND_INLINE_ACTION(*this, orderassrec, {_self, "active"_n}, {order_info.order_id, {{reserve, OrderReceiptAddReserve}, {-user_to_deposit, OrderReceiptDeposit}, {-user_to_pay, OrderReceiptRenew}}, order_info.user, ACC_TYPE_USER, time_point_sec(current_time_point())});
+    order_receipt(order_info, 1);
+    challenge_receipt(challenge_info, true);
+    SEND_RECEIPT(*this, billsnap, {bill_info});
+    SEND_RECEIPT(*this, assetrec, {order_info.order_id, {reserve}, order_info.user, AssetReceiptAddReserve});
+    SEND_RECEIPT(*this, orderassrec, {order_info.order_id, {{reserve, OrderReceiptAddReserve}, {-user_to_deposit, OrderReceiptDeposit}, {-user_to_pay, OrderReceiptRenew}}, order_info.user, ACC_TYPE_USER, time_point_sec(current_time_point())});
+}
+
+void token::syncbills(uint64_t limit) {
+    require_auth(dmc_account);
+    // index the bills billed before bill levels existed, ${limit} bills at a time
+    bill_stats sst(get_self(), get_self().value);
+    auto bill_iter = sst.lower_bound(get_dmc_config("billsyncid"_n, 0));
+    for (uint64_t count = 0; bill_iter != sst.end() && count < limit; bill_iter++, count++) {
+        update_bill_level(bill_iter->bill_id, bill_iter->price, bill_iter->unmatched.quantity.amount, get_self());
+    }
+    set_dmc_config("billsyncid"_n, bill_iter == sst.end() ? get_dmc_config("billid"_n, default_id_start) : bill_iter->bill_id);
+}
+
+void token::update_bill_level(uint64_t bill_id, uint64_t price, uint64_t unmatched, name payer) {
+    bill_levels level_tbl(get_self(), get_self().value);
+    bill_matches match_tbl(get_self(), get_self().value);
+
+    auto match_iter = match_tbl.find(bill_id);
+    if (match_iter == match_tbl.end() && unmatched == 0)
+        return;
+
+    // take the bill out of the level it was in
+    bool indexed = match_iter != match_tbl.end();
+    uint64_t old_price = indexed ? match_iter->price : 0;
+    if (indexed) {
+        auto level_iter = level_tbl.find(old_price);
+        check(level_iter != level_tbl.end(), "no such bill level");
+        if (level_iter->bill_count == 1) {
+            level_tbl.erase(level_iter);
+        } else {
+            level_tbl.modify(level_iter, get_self(), [&](auto& l) {
+                l.unmatched -= match_iter->unmatched;
+                l.bill_count -= 1;
+            });
+        }
+    }
+
+    if (unmatched == 0) {
+        match_tbl.erase(match_iter);
+    } else {
+        // a bill's row stays with whoever paid for it, the owner when billed, the contract for older bills
+        if (!indexed) {
+            match_tbl.emplace(payer, [&](auto& m) {
+                m.bill_id = bill_id;
+                m.price = price;
+                m.unmatched = unmatched;
+            });
+        } else {
+            match_tbl.modify(match_iter, same_payer, [&](auto& m) {
+                m.price = price;
+                m.unmatched = unmatched;
+            });
+        }
+
+        auto level_iter = level_tbl.find(price);
+        if (level_iter == level_tbl.end()) {
+            level_tbl.emplace(get_self(), [&](auto& l) {
+                l.price = price;
+                l.unmatched = unmatched;
+                l.bill_count = 1;
+                l.max_unmatched = unmatched;
+            });
+        } else {
+            level_tbl.modify(level_iter, get_self(), [&](auto& l) {
+                l.unmatched += unmatched;
+                l.bill_count += 1;
+            });
+        }
+        update_bill_level_max(level_tbl, match_tbl, price);
+    }
+    if (indexed && (old_price != price || unmatched == 0)) {
+        update_bill_level_max(level_tbl, match_tbl, old_price);
+    }
+}
+
+void token::update_bill_level_max(bill_levels& level_tbl, bill_matches& match_tbl, uint64_t price) {
+    auto level_iter = level_tbl.find(price);
+    if (level_iter == level_tbl.end())
+        return;
+
+    // the largest bill at the price is the last one before the next price
+    auto match_idx = match_tbl.get_index<"byprice"_n>();
+    auto match_iter = match_idx.lower_bound(bill_match::key(price + 1, 0));
+    match_iter--;
+    if (level_iter->max_unmatched != match_iter->unmatched) {
+        level_tbl.modify(level_iter, get_self(), [&](auto& l) {
+            l.max_unmatched = match_iter->unmatched;
+        });
+    }
 }
 
 void token::increase(name owner, extended_asset asset, name miner) {
@@ -317,8 +551,10 @@ void token::increase(name owner, extended_asset asset, name miner) {
             check(p_iter->weight / (total_weight * (1 - iter->miner_rate)) >= 0.01, "the quantity of increase is insufficient.");
         }
     }
-    SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {*iter});
-    SEND_INLINE_ACTION(*this, makerpoolrec, {_self, "active"_n}, {miner, {*p_iter}});
+    expire_lp_snapshot(miner);
+
+    SEND_RECEIPT(*this, makerecord, {*iter});
+    SEND_RECEIPT(*this, makerpoolrec, {miner, {*p_iter}});
 }
 
 void token::redemption(name owner, double rate, name miner) {
@@ -328,6 +564,8 @@ void token::redemption(name owner, double rate, name miner) {
     dmc_makers maker_tbl(get_self(), get_self().value);
     auto iter = maker_tbl.find(miner.value);
     check(iter != maker_tbl.end(), "no such record");
+    liquidation_states liq_tbl(get_self(), get_self().value);
+    check(liq_tbl.find(miner.value) == liq_tbl.end(), "maker is being liquidated");
 
     dmc_maker_pool dmc_pool(get_self(), miner.value);
     auto p_iter = dmc_pool.find(owner.value);
@@ -380,7 +618,7 @@ void token::redemption(name owner, double rate, name miner) {
     }
     check(rede_quantity.quantity.amount > 0, "dust attack detected");
     exchange_balance_to_lockbalance(owner, rede_quantity, time_point_sec(current_time_point() + eosio::days(3)), owner);
-    SEND_INLINE_ACTION(*this, redeemrec, {get_self(), "active"_n}, {owner, miner, rede_quantity});
+    SEND_RECEIPT(*this, redeemrec, {owner, miner, rede_quantity});
     if (total_staked.quantity.amount == 0) {
         // for tracker
         maker_tbl.modify(iter, get_self(), [&](auto& m) {
@@ -389,8 +627,11 @@ void token::redemption(name owner, double rate, name miner) {
 
         dmc_orders order_tbl(get_self(), get_self().value);
         auto order_idx = order_tbl.get_index<"miner"_n>();
-        auto order_iter = order_idx.find(miner.value);
-        check(order_iter == order_idx.end(), "maker has orders");
+        auto order_iter = order_idx.lower_bound(dmc_order_v2::get_owner_id(miner, 0));
+        check(order_iter == order_idx.end() || order_iter->miner != miner, "maker has orders");
+        dmc_orders_v1 old_order_tbl(get_self(), get_self().value);
+        auto old_order_idx = old_order_tbl.get_index<"miner"_n>();
+        check(old_order_idx.find(miner.value) == old_order_idx.end(), "maker has orders");
 
         maker_tbl.erase(iter);
     } else {
@@ -409,8 +650,10 @@ void token::redemption(name owner, double rate, name miner) {
         check(p_iter->weight / (iter->total_weight * (1 - iter->miner_rate)) >= 0.01, "The remaining weight is too low");
     }
 
-    SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {*iter});
-    SEND_INLINE_ACTION(*this, makerpoolrec, {_self, "active"_n}, {miner, {*p_iter}});
+    expire_lp_snapshot(miner);
+
+    SEND_RECEIPT(*this, makerecord, {*iter});
+    SEND_RECEIPT(*this, makerpoolrec, {miner, {*p_iter}});
 }
 
 void token::mint(name owner, extended_asset asset) {
@@ -441,7 +684,7 @@ void token::mint(name owner, extended_asset asset) {
         m.current_rate = r;
     });
 
-    SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {iter});
+    SEND_RECEIPT(*this, makerecord, {iter});
 }
 
 void token::setmakerrate(name owner, double rate) {
@@ -459,7 +702,7 @@ void token::setmakerrate(name owner, double rate) {
         s.miner_rate = rate;
     });
 
-    SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {iter});
+    SEND_RECEIPT(*this, makerecord, {iter});
 }
 
 void token::setmakerbstr(name owner, uint64_t self_benchmark_stake_rate) {
@@ -486,7 +729,7 @@ void token::setmakerbstr(name owner, uint64_t self_benchmark_stake_rate) {
         s.rate_updated_at = now;
     });
 
-    SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {iter});
+    SEND_RECEIPT(*this, makerecord, {iter});
 }
 
 double token::cal_current_rate(extended_asset dmc_asset, name owner, double real_m) {
@@ -502,20 +745,47 @@ double token::cal_current_rate(extended_asset dmc_asset, name owner, double real
 void token::liquidation(string memo) {
     require_auth(dmc_account);
     check(memo.size() <= 256, "memo has more than 256 bytes");
+    double benchmark_price = get_benchmark_price();
+    uint64_t rows = get_dmc_config("liqrows"_n, default_liquidation_rows);
+
+    // finish the miners left half way by the last call first
+    liquidation_states liq_tbl(get_self(), get_self().value);
+    for (auto liq_it = liq_tbl.begin(); liq_it != liq_tbl.end() && rows > 0;) {
+        liquidation_state liq = *liq_it;
+        if (!liquidate_bills(liq, rows)) {
+            liq_tbl.modify(liq_it, get_self(), [&](auto& l) {
+                l = liq;
+            });
+            return;
+        }
+        finish_liquidation(liq);
+        liq_it = liq_tbl.erase(liq_it);
+    }
+
     dmc_makers maker_tbl(get_self(), get_self().value);
     auto maker_idx = maker_tbl.get_index<"byrate"_n>();
-
     pststats pst_acnts(get_self(), get_self().value);
-    constexpr uint64_t required_size = 20;
-    std::vector<std::tuple<name /* miner */, extended_asset /* pst_asset */, extended_asset /* dmc_asset */>> liquidation_required;
-    liquidation_required.reserve(required_size);
+    // by_rate is r / n and does not move with the price, makers below price / 100 are under-collateralized.
+    // calbonus and the penalty move makers in byrate, so they are collected before any is liquidated
+    auto maker_end = maker_idx.lower_bound(benchmark_price / 100.0);
+    std::vector<name> unhealthy;
+    for (auto maker_it = maker_idx.cbegin(); maker_it != maker_end && unhealthy.size() < rows; maker_it++) {
+        if (liq_tbl.find(maker_it->miner.value) == liq_tbl.end()) {
+            unhealthy.push_back(maker_it->miner);
+        }
+    }
 
-    for (auto maker_it = maker_idx.cbegin(); maker_it != maker_idx.cend() && maker_it->current_rate < get_dmc_rate(maker_it->get_n()) && liquidation_required.size() < required_size; maker_it++) {
-        name owner = maker_it->miner;
+    std::vector<liquidation_state> liquidation_required;
+    for (auto owner : unhealthy) {
+        if (rows == 0) {
+            break;
+        }
+        rows--;
+        auto maker_it = maker_tbl.find(owner.value);
         double r1 = maker_it->current_rate;
         auto pst_it = pst_acnts.find(owner.value);
 
-        double m = get_dmc_rate(maker_it->benchmark_stake_rate);
+        double m = get_dmc_rate(maker_it->benchmark_stake_rate, benchmark_price);
         double sub_pst = (double)(1 - r1 / m) * get_real_asset(pst_it->amount);
         extended_asset liq_pst_asset_leftover = get_asset_by_amount<double, std::ceil>(sub_pst, pst_sym);
         auto origin_liq_pst_asset = liq_pst_asset_leftover;
@@ -527,167 +797,173 @@ void token::liquidation(string memo) {
             extended_asset pst_sub = extended_asset(std::min(liq_pst_asset_leftover.quantity.amount, account_it->balance.quantity.amount), pst_sym);
 
             sub_balance(owner, pst_sub);
-            SEND_INLINE_ACTION(*this, currliqrec, {_self, "active"_n}, {owner, pst_sub});
+            SEND_RECEIPT(*this, currliqrec, {owner, pst_sub});
             liq_pst_asset_leftover.quantity.amount = std::max((liq_pst_asset_leftover - pst_sub).quantity.amount, 0ll);
         }
 
-        bill_stats sst(get_self(), get_self().value);
-        auto bill_idx = sst.get_index<"byowner"_n>();
-        auto bill_it = bill_idx.lower_bound(owner.value);
-
-        for (; bill_it != bill_idx.end() && liq_pst_asset_leftover.quantity.amount > 0 && bill_it->owner == owner;) {
-            extended_asset sub_pst;
-            if (bill_it->unmatched <= liq_pst_asset_leftover) {
-                sub_pst = bill_it->unmatched;
-                liq_pst_asset_leftover -= bill_it->unmatched;
-            } else {
-                sub_pst = liq_pst_asset_leftover;
-                liq_pst_asset_leftover.quantity.amount = 0;
-            }
-
-            uint64_t bill_id = bill_it->bill_id;
-            uint64_t now_time_t = calbonus(owner, bill_id, _self);
-
-            bill_idx.modify(bill_it, get_self(), [&](auto& r) {
-                r.unmatched -= sub_pst;
-                r.updated_at = time_point_sec(now_time_t);
-                // for tracker
-                if (r.unmatched.quantity.amount == 0)
-                    r.price = 0;
+        double penalty_dmc = (double)(1 - r1 / m) * get_real_asset(maker_it->total_staked) * get_dmc_config("penaltyrate"_n, default_penalty_rate) / 100.0;
+        liquidation_state liq = {
+            .miner = owner,
+            .pst = origin_liq_pst_asset,
+            .leftover = liq_pst_asset_leftover,
+            .penalty = get_asset_by_amount<double, std::ceil>(penalty_dmc, dmc_sym),
+        };
+        if (liquidate_bills(liq, rows)) {
+            liquidation_required.push_back(liq);
+        } else {
+            liq_tbl.emplace(get_self(), [&](auto& l) {
+                l = liq;
             });
+        }
+    }
 
-            SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {*bill_it});
-            if (bill_it->unmatched.quantity.amount == 0)
-                bill_it = bill_idx.erase(bill_it);
-            else
-                bill_it++;
+    for (const auto& liq : liquidation_required) {
+        finish_liquidation(liq);
+    }
+}
 
-            SEND_INLINE_ACTION(*this, billliqrec, {_self, "active"_n}, {owner, bill_id, sub_pst});
-        }
-        extended_asset sub_pst_asset = origin_liq_pst_asset - liq_pst_asset_leftover;
-        double penalty_dmc = (double)(1 - r1 / m) * get_real_asset(maker_it->total_staked) * get_dmc_config("penaltyrate"_n, default_penalty_rate) / 100.0;
-        extended_asset penalty_dmc_asset = get_asset_by_amount<double, std::ceil>(penalty_dmc, dmc_sym);
-        if (sub_pst_asset.quantity.amount != 0 && penalty_dmc_asset.quantity.amount != 0) {
-            liquidation_required.emplace_back(std::make_tuple(owner, sub_pst_asset, penalty_dmc_asset));
+bool token::liquidate_bills(liquidation_state& liq, uint64_t& rows) {
+    bill_stats sst(get_self(), get_self().value);
+    auto bill_idx = sst.get_index<"byowner"_n>();
+    // fully liquidated bills are erased, so the walk resumes at the first bill left
+    auto bill_it = bill_idx.lower_bound(liq.miner.value);
+
+    for (; bill_it != bill_idx.end() && liq.leftover.quantity.amount > 0 && bill_it->owner == liq.miner && rows > 0; rows--) {
+        extended_asset sub_pst;
+        if (bill_it->unmatched <= liq.leftover) {
+            sub_pst = bill_it->unmatched;
+            liq.leftover -= bill_it->unmatched;
+        } else {
+            sub_pst = liq.leftover;
+            liq.leftover.quantity.amount = 0;
         }
-    }
 
-    for (const auto liq : liquidation_required) {
-        name miner;
-        extended_asset pst;
-        extended_asset dmc;
-        std::tie(miner, pst, dmc) = liq;
-        auto pst_it = pst_acnts.find(miner.value);
-        change_pst(miner, -pst);
-        auto iter = maker_tbl.find(miner.value);
-        extended_asset new_staked = iter->total_staked - dmc;
-        double new_rate = cal_current_rate(new_staked, miner, iter->get_real_m());
-        maker_tbl.modify(iter, get_self(), [&](auto& s) {
-            s.total_staked = new_staked;
-            s.current_rate = new_rate;
+        uint64_t bill_id = bill_it->bill_id;
+        uint64_t now_time_t = calbonus(liq.miner, *bill_it);
+
+        update_bill_level(bill_id, bill_it->price, (bill_it->unmatched - sub_pst).quantity.amount, get_self());
+        bill_idx.modify(bill_it, get_self(), [&](auto& r) {
+            r.unmatched -= sub_pst;
+            r.updated_at = time_point_sec(now_time_t);
+            // for tracker
+            if (r.unmatched.quantity.amount == 0)
+                r.price = 0;
         });
-        add_balance(system_account, dmc, dmc_account);
-        SEND_INLINE_ACTION(*this, makerecord, {_self, "active"_n}, {*iter});
-        SEND_INLINE_ACTION(*this, liqrec, {_self, "active"_n}, {miner, pst, dmc});
+
+        SEND_RECEIPT(*this, billsnap, {*bill_it});
+        if (bill_it->unmatched.quantity.amount == 0)
+            bill_it = bill_idx.erase(bill_it);
+        else
+            bill_it++;
+
+        SEND_RECEIPT(*this, billliqrec, {liq.miner, bill_id, sub_pst});
+    }
+    settle_incentive(liq.miner, get_self());
+    return liq.leftover.quantity.amount == 0 || bill_it == bill_idx.end() || bill_it->owner != liq.miner;
+}
+
+void token::finish_liquidation(const liquidation_state& liq) {
+    extended_asset pst = liq.pst - liq.leftover;
+    if (pst.quantity.amount == 0 || liq.penalty.quantity.amount == 0) {
+        return;
+    }
+    change_pst(liq.miner, -pst);
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    auto iter = maker_tbl.find(liq.miner.value);
+    // redemption waits for a pending liquidation, the row can only be missing for one left pending before it did
+    if (iter == maker_tbl.end()) {
+        SEND_RECEIPT(*this, liqrec, {liq.miner, pst, extended_asset(0, dmc_sym)});
+        return;
     }
+    extended_asset dmc = liq.penalty.quantity > iter->total_staked.quantity ? iter->total_staked : liq.penalty;
+    extended_asset new_staked = iter->total_staked - dmc;
+    double new_rate = cal_current_rate(new_staked, liq.miner, iter->get_real_m());
+    maker_tbl.modify(iter, get_self(), [&](auto& s) {
+        s.total_staked = new_staked;
+        s.current_rate = new_rate;
+    });
+    add_balance(system_account, dmc, dmc_account);
+    SEND_RECEIPT(*this, makerecord, {*iter});
+    SEND_RECEIPT(*this, liqrec, {liq.miner, pst, dmc});
 }
 
 void token::getincentive(name owner, uint64_t bill_id) {
     require_auth(owner);
-    // TODO: delete it after
-    check(get_dmc_config("olderbillid"_n, default_id_start) <= bill_id, "this bill can only be unbilled");
-    uint64_t now_time_t = calbonus(owner, bill_id, owner);
     bill_stats sst(get_self(), get_self().value);
-    // check bill_id in calbouns, so no need to check here
     auto ust = sst.find(bill_id);
     check(ust != sst.end(), "no such record");
+    check(ust->owner == owner, "bill_id not belong to you");
+    uint64_t now_time_t = calbonus(owner, *ust);
+    settle_incentive(owner, owner);
     sst.modify(ust, get_self(), [&](auto& s) {
         s.updated_at = time_point_sec(now_time_t);
     });
-    SEND_INLINE_ACTION(*this, billsnap, {_self, "active"_n}, {*ust});
-}
-
-uint64_t token::calbonus(name owner, uint64_t bill_id, name ram_payer) {
-    // TODO: delete it after
-    if (bill_id < get_dmc_config("olderbillid"_n, default_id_start)) {
-        bill_stats sst(get_self(), owner.value);
-        auto ust = sst.find(bill_id);
-        check(ust != sst.end(), "no such record");
-        dmc_makers maker_tbl(get_self(), get_self().value);
-        const auto& iter = maker_tbl.get(owner.value, "no such pst maker");
-
-        auto now_time = time_point_sec(current_time_point());
-        uint64_t now_time_t = now_time.sec_since_epoch();
-        uint64_t updated_at_t = ust->updated_at.sec_since_epoch();
-        uint64_t bill_dmc_claims_interval = get_dmc_config("billinter"_n, default_bill_dmc_claims_interval);
-        uint64_t max_dmc_claims_interval = ust->created_at.sec_since_epoch() + bill_dmc_claims_interval;
-
-        now_time_t = now_time_t >= max_dmc_claims_interval ? max_dmc_claims_interval : now_time_t;
-
-        if (updated_at_t <= max_dmc_claims_interval) {
-            uint64_t duration = now_time_t - updated_at_t;
-            check(duration <= now_time_t, "subtractive overflow");  // never happened
-
-            extended_asset quantity = get_asset_by_amount<double, std::floor>(
-                incentive_rate * duration * ust->unmatched.quantity.amount * get_dmc_config("bmrate"_n, default_benchmark_stake_rate) / 100.0 / bill_dmc_claims_interval,
-                rsi_sym);
-
-            if (quantity.quantity.amount > 0) {
-                extended_asset dmc_quantity = get_dmc_by_vrsi(quantity);
-
-                if (dmc_quantity.quantity.amount > 0) {
-                    maker_tbl.modify(iter, ram_payer, [&](auto& s) {
-                        s.total_staked += dmc_quantity;
-                        s.current_rate = cal_current_rate(s.total_staked, owner, s.get_real_m());
-                    });
-                    SEND_INLINE_ACTION(*this, incentiverec, {_self, "active"_n}, {owner, dmc_quantity, bill_id});
-                }
-            } else {
-                // if quantity is 0, don't update updated_at
-                now_time_t = updated_at_t;
-            }
+    SEND_RECEIPT(*this, billsnap, {*ust});
+}
+
+uint64_t token::calbonus(name owner, const bill_record& bill) {
+    auto now_time = time_point_sec(current_time_point());
+    uint64_t now_time_t = now_time.sec_since_epoch();
+    uint64_t updated_at_t = bill.updated_at.sec_since_epoch();
+    uint64_t bill_dmc_claims_interval = get_dmc_config("billinter"_n, default_bill_dmc_claims_interval);
+    uint64_t max_dmc_claims_interval = bill.created_at.sec_since_epoch() + bill_dmc_claims_interval;
+
+    now_time_t = now_time_t >= max_dmc_claims_interval ? max_dmc_claims_interval : now_time_t;
+
+    if (updated_at_t <= max_dmc_claims_interval) {
+        uint64_t duration = now_time_t - updated_at_t;
+        check(duration <= now_time_t, "subtractive overflow");  // never happened
+
+        extended_asset quantity = get_asset_by_amount<double, std::floor>(
+            incentive_rate * duration * bill.unmatched.quantity.amount * get_dmc_config("bmrate"_n, default_benchmark_stake_rate) / 100.0 / bill_dmc_claims_interval,
+            rsi_sym);
+
+        if (quantity.quantity.amount > 0) {
+            // exchanged to dmc by settle_incentive
+            _incentive_cache[owner.value].emplace_back(bill.bill_id, quantity);
+        } else {
+            // if quantity is 0, don't update updated_at
+            now_time_t = updated_at_t;
         }
-        return now_time_t;
-    } else {
-        bill_stats sst(get_self(), get_self().value);
-        auto ust = sst.find(bill_id);
-        check(ust != sst.end(), "no such record");
-        check(ust->owner == owner, "bill_id not belong to you");
-        dmc_makers maker_tbl(get_self(), get_self().value);
-        const auto& iter = maker_tbl.get(owner.value, "no such pst maker");
-
-        auto now_time = time_point_sec(current_time_point());
-        uint64_t now_time_t = now_time.sec_since_epoch();
-        uint64_t updated_at_t = ust->updated_at.sec_since_epoch();
-        uint64_t bill_dmc_claims_interval = get_dmc_config("billinter"_n, default_bill_dmc_claims_interval);
-        uint64_t max_dmc_claims_interval = ust->created_at.sec_since_epoch() + bill_dmc_claims_interval;
-
-        now_time_t = now_time_t >= max_dmc_claims_interval ? max_dmc_claims_interval : now_time_t;
-
-        if (updated_at_t <= max_dmc_claims_interval) {
-            uint64_t duration = now_time_t - updated_at_t;
-            check(duration <= now_time_t, "subtractive overflow");  // never happened
-
-            extended_asset quantity = get_asset_by_amount<double, std::floor>(
-                incentive_rate * duration * ust->unmatched.quantity.amount * get_dmc_config("bmrate"_n, default_benchmark_stake_rate) / 100.0 / bill_dmc_claims_interval,
-                rsi_sym);
-
-            if (quantity.quantity.amount > 0) {
-                extended_asset dmc_quantity = get_dmc_by_vrsi(quantity);
-
-                if (dmc_quantity.quantity.amount > 0) {
-                    maker_tbl.modify(iter, ram_payer, [&](auto& s) {
-                        s.total_staked += dmc_quantity;
-                        s.current_rate = cal_current_rate(s.total_staked, owner, s.get_real_m());
-                    });
-                    SEND_INLINE_ACTION(*this, incentiverec, {_self, "active"_n}, {owner, dmc_quantity, bill_id});
-                }
-            } else {
-                // if quantity is 0, don't update updated_at
-                now_time_t = updated_at_t;
-            }
+    }
+    return now_time_t;
+}
+
+void token::settle_incentive(name owner, name ram_payer) {
+    auto cache_iter = _incentive_cache.find(owner.value);
+    if (cache_iter == _incentive_cache.end()) {
+        return;
+    }
+    auto incentives = std::move(cache_iter->second);
+    _incentive_cache.erase(cache_iter);
+
+    extended_asset total_rsi = extended_asset(0, rsi_sym);
+    for (const auto& incentive : incentives) {
+        total_rsi += incentive.second;
+    }
+    extended_asset total_dmc = get_dmc_by_vrsi(total_rsi);
+    if (total_dmc.quantity.amount <= 0) {
+        return;
+    }
+
+    dmc_makers maker_tbl(get_self(), get_self().value);
+    const auto& iter = maker_tbl.get(owner.value, "no such pst maker");
+    maker_tbl.modify(iter, ram_payer, [&](auto& s) {
+        s.total_staked += total_dmc;
+        s.current_rate = cal_current_rate(s.total_staked, owner, s.get_real_m());
+    });
+
+    // share the exchanged dmc by rsi, the last bill takes the rounding remainder
+    extended_asset remain_dmc = total_dmc;
+    for (uint64_t i = 0; i < incentives.size(); i++) {
+        extended_asset dmc_quantity = remain_dmc;
+        if (i + 1 < incentives.size()) {
+            dmc_quantity = extended_asset(int64_t(uint128_t(total_dmc.quantity.amount) * incentives[i].second.quantity.amount / total_rsi.quantity.amount), dmc_sym);
+            remain_dmc -= dmc_quantity;
+        }
+        if (dmc_quantity.quantity.amount > 0) {
+            SEND_RECEIPT(*this, incentiverec, {owner, dmc_quantity, incentives[i].first});
         }
-        return now_time_t;
     }
 }
 
@@ -699,6 +975,14 @@ void token::setabostats(uint64_t stage, double user_rate, double foundation_rate
     check(start_at < end_at, "invalid time");
     check(total_release.get_extended_symbol() == dmc_sym, "invalid symbol");
 
+    // a stage behind the release cursors is walked again
+    if (get_dmc_config("aboustage"_n, 0) > stage) {
+        set_dmc_config("aboustage"_n, stage);
+    }
+    if (get_dmc_config("abofstage"_n, 0) > stage) {
+        set_dmc_config("abofstage"_n, stage);
+    }
+
     abostats ast(get_self(), get_self().value);
     const auto& st = ast.find(stage);
     if (st != ast.end()) {
@@ -726,48 +1010,61 @@ void token::setabostats(uint64_t stage, double user_rate, double foundation_rate
 
 void token::setdmcconfig(name key, uint64_t value) {
     require_auth(config_account);
-    dmc_global dmc_global_tbl(get_self(), get_self().value);
     switch (key.value) {
         case ("claiminter"_n).value:
             check(value > 0, "invalid claims interval");
             break;
+        case ("fullrecint"_n).value:
+            check(value > 0, "invalid full receipt interval");
+            break;
         default:
             break;
     }
-    auto config_itr = dmc_global_tbl.find(key.value);
-    if (config_itr == dmc_global_tbl.end()) {
-        dmc_global_tbl.emplace(_self, [&](auto& conf) {
-            conf.key = key;
-            conf.value = value;
-        });
-    } else {
-        dmc_global_tbl.modify(config_itr, get_self(), [&](auto& conf) {
-            conf.value = value;
-        });
-    }
+    set_dmc_config(key, value);
 }
 
 uint64_t token::get_dmc_config(name key, uint64_t default_value) {
-    dmc_global dmc_global_tbl(get_self(), get_self().value);
-    auto dmc_global_iter = dmc_global_tbl.find(key.value);
-    if (dmc_global_iter != dmc_global_tbl.end())
-        return dmc_global_iter->value;
-    return default_value;
+#ifdef DMC_PROFILE
+    host::notify_config(key);
+#endif
+    auto config_itr = _config_cache.find(key.value);
+    if (config_itr == _config_cache.end()) {
+        dmc_global dmc_global_tbl(get_self(), get_self().value);
+        auto dmc_global_iter = dmc_global_tbl.find(key.value);
+        config_cache_entry conf = {
+            .value = dmc_global_iter != dmc_global_tbl.end() ? dmc_global_iter->value : 0,
+            .exists = dmc_global_iter != dmc_global_tbl.end(),
+            .dirty = false};
+        config_itr = _config_cache.emplace(key.value, conf).first;
+    }
+    return config_itr->second.exists ? config_itr->second.value : default_value;
 }
 
 void token::set_dmc_config(name key, uint64_t value) {
-    dmc_global dmc_global_tbl(get_self(), get_self().value);
-    auto config_itr = dmc_global_tbl.find(key.value);
+    // written to dmcconfig when the action ends, see flush_dmc_config
+    auto& conf = _config_cache[key.value];
+    conf.value = value;
+    conf.exists = true;
+    conf.dirty = true;
+}
 
-    if (config_itr == dmc_global_tbl.end()) {
-        dmc_global_tbl.emplace(_self, [&](auto& conf) {
-            conf.key = key;
-            conf.value = value;
-        });
-    } else {
-        dmc_global_tbl.modify(config_itr, get_self(), [&](auto& conf) {
-            conf.value = value;
-        });
+void token::flush_dmc_config() {
+    dmc_global dmc_global_tbl(get_self(), get_self().value);
+    for (auto& cache : _config_cache) {
+        if (!cache.second.dirty)
+            continue;
+        auto config_itr = dmc_global_tbl.find(cache.first);
+        if (config_itr == dmc_global_tbl.end()) {
+            dmc_global_tbl.emplace(_self, [&](auto& conf) {
+                conf.key = name(cache.first);
+                conf.value = cache.second.value;
+            });
+        } else {
+            dmc_global_tbl.modify(config_itr, get_self(), [&](auto& conf) {
+                conf.value = cache.second.value;
+            });
+        }
+        cache.second.dirty = false;
     }
 }
 
@@ -782,34 +1079,42 @@ double token::get_benchmark_price() {
 }
 
 double token::get_dmc_rate(uint64_t rate_value) {
+    return get_dmc_rate(rate_value, get_benchmark_price());
+}
+
+double token::get_dmc_rate(uint64_t rate_value, double benchmark_price) {
     double value = rate_value / 100.0;
-    return value * get_benchmark_price();
+    return value * benchmark_price;
 }
 
 void token::trace_price_history(double price, uint64_t bill_id, uint64_t order_id) {
     price_table ptb(get_self(), get_self().value);
-    auto iter = ptb.get_index<"bytime"_n>();
+    price_levels levels(get_self(), get_self().value);
+    price_stats pst(get_self(), get_self().value);
     auto now_time = time_point_sec(current_time_point());
-    const uint64_t max_price_distance = get_dmc_config("pricedist"_n, default_max_price_distance);
+    uint64_t today = now_time.sec_since_epoch() / day_sec;
+    // the day being traced is always kept
+    const uint64_t max_price_distance = std::max(get_dmc_config("pricedist"_n, default_max_price_distance), uint64_t(1));
+    uint64_t price_t = std::round(price * 10000);
 
-    std::vector<double> prices;
-    prices.push_back(price);
+    auto stat_iter = pst.find(0);
+    price_stat stat = stat_iter == pst.end() ? init_price_stat(ptb, levels) : *stat_iter;
 
-    int times = 0;
-    auto rawtime = now_time;
-    for (auto it = iter.begin(); it != iter.end();) {
-        prices.push_back(it->price);
-        if (rawtime.sec_since_epoch() / day_sec != it->created_at.sec_since_epoch() / day_sec) {
-            times++;
-        }
-        if (times >= max_price_distance) {
-            // remove the oldest price
-            prices.pop_back();
-            it = iter.erase(it);
-        } else {
-            rawtime = it->created_at;
-            it++;
+    if (stat.days == 0 || stat.last_day != today) {
+        stat.days++;
+        stat.last_day = today;
+    }
+    // remove the prices of the oldest day, one day at a time
+    auto time_idx = ptb.get_index<"bytime"_n>();
+    while (stat.days > max_price_distance) {
+        auto oldest_iter = time_idx.end();
+        oldest_iter--;
+        uint64_t oldest_day = oldest_iter->created_at.sec_since_epoch() / day_sec;
+        for (auto it = time_idx.lower_bound(uint64_max - ((oldest_day + 1) * day_sec - 1)); it != time_idx.end();) {
+            sub_price_level(levels, stat, std::round(it->price * 10000));
+            it = time_idx.erase(it);
         }
+        stat.days--;
     }
 
     ptb.emplace(_self, [&](auto& p) {
@@ -819,18 +1124,32 @@ void token::trace_price_history(double price, uint64_t bill_id, uint64_t order_i
         p.price = price;
         p.created_at = now_time;
     });
+    add_price_level(levels, stat, price_t);
+
+    // calculate median price, the upper median of an even count may be on the next level
+    auto median_iter = levels.find(stat.median);
+    uint64_t upper_price = stat.median;
+    std::vector<double> prices = {stat.median / 10000.0};
+    if (stat.total % 2 == 0) {
+        if (stat.below + median_iter->count == stat.total / 2) {
+            median_iter++;
+            upper_price = median_iter->price;
+        }
+        prices.push_back(upper_price / 10000.0);
+    }
+    // convert to 4 decimal places
+    double bc_price = std::floor((stat.median + upper_price) / 2.0) / 10000.0;
 
-    // calculate median price
-    std::sort(prices.begin(), prices.end());
-    auto size = prices.size();
-    double bc_price = 0;
-    if (size % 2 == 0) {
-        bc_price = (prices[size / 2 - 1] + prices[size / 2]) / 2;
+    if (stat_iter == pst.end()) {
+        pst.emplace(_self, [&](auto& s) {
+            s = stat;
+        });
     } else {
-        bc_price = prices[size / 2];
+        pst.modify(stat_iter, _self, [&](auto& s) {
+            s = stat;
+        });
     }
-    // convert to 4 decimal places
-    bc_price = std::floor(bc_price * 10000) / 10000.0;
+
     bc_price_table bptb(get_self(), get_self().value);
     auto bptb_iter = bptb.begin();
     if (bptb_iter == bptb.end()) {
@@ -846,7 +1165,105 @@ void token::trace_price_history(double price, uint64_t bill_id, uint64_t order_i
     }
 }
 
+token::price_stat token::init_price_stat(price_table& ptb, price_levels& levels) {
+    price_stat stat = {
+        .total = 0,
+        .median = 0,
+        .below = 0,
+        .days = 0,
+        .last_day = 0};
+
+    // rebuild the levels from the prices traced before the levels existed
+    auto time_idx = ptb.get_index<"bytime"_n>();
+    uint64_t current_day = 0;
+    for (auto it = time_idx.begin(); it != time_idx.end(); it++) {
+        uint64_t day = it->created_at.sec_since_epoch() / day_sec;
+        if (stat.days == 0) {
+            stat.last_day = day;
+        }
+        if (stat.days == 0 || day != current_day) {
+            current_day = day;
+            stat.days++;
+        }
+        add_price_level(levels, stat, std::round(it->price * 10000));
+    }
+    return stat;
+}
+
+void token::add_price_level(price_levels& levels, price_stat& stat, uint64_t price) {
+    auto level_iter = levels.find(price);
+    if (level_iter == levels.end()) {
+        levels.emplace(_self, [&](auto& l) {
+            l.price = price;
+            l.count = 1;
+        });
+    } else {
+        levels.modify(level_iter, _self, [&](auto& l) {
+            l.count++;
+        });
+    }
+
+    if (stat.total == 0) {
+        stat.median = price;
+        stat.below = 0;
+    } else if (price < stat.median) {
+        stat.below++;
+    }
+    stat.total++;
+    balance_price_median(levels, stat);
+}
+
+void token::sub_price_level(price_levels& levels, price_stat& stat, uint64_t price) {
+    auto level_iter = levels.find(price);
+    check(level_iter != levels.end(), "no such price level");
+
+    stat.total--;
+    if (price < stat.median) {
+        stat.below--;
+    }
+    if (level_iter->count > 1) {
+        levels.modify(level_iter, _self, [&](auto& l) {
+            l.count--;
+        });
+    } else {
+        level_iter = levels.erase(level_iter);
+        // the median level is gone, move to the next one, or to the previous one if it was the last
+        if (price == stat.median && stat.total > 0) {
+            if (level_iter == levels.end()) {
+                level_iter--;
+                stat.below -= level_iter->count;
+            }
+            stat.median = level_iter->price;
+        }
+    }
+
+    if (stat.total == 0) {
+        stat.median = 0;
+        stat.below = 0;
+        return;
+    }
+    balance_price_median(levels, stat);
+}
+
+void token::balance_price_median(price_levels& levels, price_stat& stat) {
+    // lower median is the k-th smallest price, one insert or remove moves it by at most one level
+    uint64_t k = (stat.total - 1) / 2;
+    auto median_iter = levels.find(stat.median);
+    check(median_iter != levels.end(), "no such price level");
+    while (k < stat.below) {
+        median_iter--;
+        stat.below -= median_iter->count;
+    }
+    while (k >= stat.below + median_iter->count) {
+        stat.below += median_iter->count;
+        median_iter++;
+    }
+    stat.median = median_iter->price;
+}
+
 void token::adjustprice(string memo) {
+    require_auth(dmc_account);
+    check(memo.size() <= 256, "memo has more than 256 bytes");
     bc_price_table bptb(get_self(), get_self().value);
     auto bptb_iter = bptb.begin();
     if (bptb_iter == bptb.end()) {
@@ -864,15 +1281,22 @@ void token::allocation(string memo) {
     extended_asset to_foundation(0, dmc_sym);
 
     auto now_time = time_point_sec(current_time_point());
-    for (auto it = ast.begin(); it != ast.end();) {
+    // stages before ${abofstage} are released to the foundation already
+    for (auto it = ast.lower_bound(get_dmc_config("abofstage"_n, 0)); it != ast.end();) {
         if (now_time > it->end_at) {
-            if (it->remaining_release.quantity.amount != 0) {
-                to_foundation.quantity.amount = it->remaining_release.quantity.amount * it->foundation_rate;
+            // the remainder of a finished stage is split once, the side that comes last takes what is left
+            if (it->last_foundation_released_at < it->end_at) {
+                extended_asset curr_release = it->remaining_release;
+                if (it->last_user_released_at < it->end_at) {
+                    curr_release.quantity.amount = it->remaining_release.quantity.amount * it->foundation_rate;
+                }
+                to_foundation += curr_release;
                 ast.modify(it, get_self(), [&](auto& a) {
                     a.last_foundation_released_at = it->end_at;
-                    a.remaining_release -= to_foundation;
+                    a.remaining_release -= curr_release;
                 });
             }
+            set_dmc_config("abofstage"_n, it->stage + 1);
             it++;
         } else if (now_time < it->start_at) {
             break;
@@ -5,24 +5,12 @@
 namespace eosio {
 
 void token::phishing_challenge() {
-    dmc_global dmc_global_tbl(get_self(), get_self().value);
-    auto phishing_date_iter = dmc_global_tbl.find("phishdate"_n.value);
-    time_point_sec phishing_date;
-    if (phishing_date_iter != dmc_global_tbl.end())
-        phishing_date = time_point_sec(phishing_date_iter->value);
-    else {
+    time_point_sec phishing_date = time_point_sec(get_dmc_config("phishdate"_n, 0));
+    if (phishing_date == time_point_sec()) {
         phishing_date = time_point_sec(current_time_point());
-        dmc_global_tbl.emplace(_self, [&](auto& conf) {
-            conf.key = "phishdate"_n;
-            conf.value = current_time_point().sec_since_epoch();
-        });
-    }
-    
-    auto phishing_interval_iter = dmc_global_tbl.find("phishinter"_n.value);
-    uint64_t phishing_interval = default_phishing_interval;
-    if (phishing_interval_iter != dmc_global_tbl.end()) {
-        phishing_interval = phishing_interval_iter->value;
+        set_dmc_config("phishdate"_n, phishing_date.sec_since_epoch());
     }
+    uint64_t phishing_interval = get_dmc_config("phishinter"_n, default_phishing_interval);
     if (phishing_date + phishing_interval > time_point_sec(current_time_point())) {
         return;
     }
@@ -41,14 +29,12 @@ void token::phishing_challenge() {
     auto state_id_iter = state_id_idx.lower_bound(dmc_order::get_state_id(OrderStateDeliver, order_id));
     if (state_id_iter != state_id_idx.end() && state_id_iter->state == OrderStateDeliver) {
         dmc_challenges challenge_tbl(get_self(), get_self().value);
-        auto challenge_iter = challenge_tbl.find(state_id_iter->order_id);
+        auto challenge_iter = find_challenge(challenge_tbl, state_id_iter->order_id);
         if (is_challenge_end(challenge_iter->state) && challenge_iter->data_block_count) {
             auto challenge_hash = sha256((char*)&tpos_mult, sizeof(uint64_t));
             uint64_t data_id = uint64_t(*reinterpret_cast<const uint64_t*>(&challenge_hash)) % challenge_iter->data_block_count;
             SEND_INLINE_ACTION(*this, reqchallenge, { _self, "active"_n }, { _self, state_id_iter->order_id, data_id, challenge_hash, std::string("phishing")});
-            dmc_global_tbl.modify(phishing_date_iter, get_self(), [&](auto& d) {
-                d.value = current_time_point().sec_since_epoch();
-            });
+            set_dmc_config("phishdate"_n, current_time_point().sec_since_epoch());
         }
     }
 }
@@ -57,7 +43,7 @@ ChallengeState token::get_challenge_state(uint64_t order_id)
 {
     uint64_t challenge_interval = get_dmc_config("challinter"_n, default_dmc_challenge_interval);
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
     if (challenge_iter->state == ChallengeRequest && challenge_iter->challenge_date + challenge_interval <= time_point_sec(current_time_point())) {
@@ -77,17 +63,17 @@ void token::addmerkle(name sender, uint64_t order_id, checksum256 merkle_root, u
     require_auth(sender);
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(sender == order_iter->user || sender == order_iter->miner, "order doesn't belong to sender");
 
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge!");
 
     check(challenge_iter->state == ChallengePrepare || is_challenge_end(challenge_iter->state), "invalid state");
     if (challenge_iter->merkle_submitter == sender || challenge_iter->merkle_submitter == _self) {
-        challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+        modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
             c.pre_merkle_root = merkle_root;
             c.pre_data_block_count = data_block_count;
             c.merkle_submitter = sender;
@@ -96,7 +82,7 @@ void token::addmerkle(name sender, uint64_t order_id, checksum256 merkle_root, u
         check(merkle_root == challenge_iter->pre_merkle_root, "merkle root mismatch");
         check(challenge_iter->pre_data_block_count == data_block_count, "block count mismatch");
         if (challenge_iter->state == ChallengePrepare) {
-            challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+            modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
                 c.state = ChallengeConsistent;
                 c.merkle_submitter = name { _self };
                 c.merkle_root = c.pre_merkle_root;
@@ -107,12 +93,12 @@ void token::addmerkle(name sender, uint64_t order_id, checksum256 merkle_root, u
 
             dmc_order order = *order_iter;
             update_order(order, *challenge_iter, sender);
-            order_tbl.modify(order_iter, sender, [&](auto& o) {
+            modify_row(order_tbl, order_iter, sender, [&](auto& o) {
                 o = order;
             });
-            SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2});
+            order_receipt(*order_iter, 2);
         } else {
-            challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+            modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
                 c.merkle_submitter = name { _self };
                 c.merkle_root = c.pre_merkle_root;
                 c.data_block_count = c.pre_data_block_count;
@@ -121,40 +107,40 @@ void token::addmerkle(name sender, uint64_t order_id, checksum256 merkle_root, u
             });
         }
     }
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { *challenge_iter });
+    challenge_receipt(*challenge_iter);
 }
 
 void token::reqchallenge(name sender, uint64_t order_id, uint64_t data_id, checksum256 hash_data, std::string nonce)
 {
     require_auth(sender);
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(sender == order_iter->user || sender == get_self(), "only user can reqchallenge");
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
     auto state = get_challenge_state(order_id);
     check(is_challenge_end(state), "invalid challenge state, cannot reqchallenge");
     check(data_id < challenge_iter->data_block_count, "invalid data number");
 
-    auto order = *order_iter;
+    dmc_order order = *order_iter;
     update_order(order, *challenge_iter, sender);
     check(order.state == OrderStateDeliver || order.state == OrderStatePreEnd || order.state == OrderStatePreCont, "order state is invalid, can't reqchallenge");
 
-    auto per_price_amount = double(order_iter->price.quantity.amount) * 0.1 / (order_iter->miner_lock_pst.quantity.amount / pow(10, pst_sym.get_symbol().precision()));
-    auto user_lock = extended_asset(per_price_amount * 100, order_iter->price.get_extended_symbol());
+    auto per_price_amount = double(order_iter->price) * 0.1 / (order_iter->miner_lock_pst / pow(10, pst_sym.get_symbol().precision()));
+    auto user_lock = extended_asset(per_price_amount * 100, dmc_sym);
     if (sender == get_self()) {
         user_lock = extended_asset(0, user_lock.get_extended_symbol());
     }
 
     check(order.user_pledge >= user_lock, "not enough dmc to challenge");
     order.user_pledge -= user_lock;
-    order_tbl.modify(order_iter, sender, [&](auto& o) {
+    modify_row(order_tbl, order_iter, sender, [&](auto& o) {
         o = order;
     });
 
-    challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+    modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
         c.data_id = data_id;
         c.hash_data = hash_data;
         c.nonce = nonce;
@@ -165,10 +151,10 @@ void token::reqchallenge(name sender, uint64_t order_id, uint64_t data_id, check
         c.challenger = sender;
     });
     if (user_lock.quantity.amount > 0) {
-        SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order_id, { {-user_lock, OrderReceiptChallengeReq}}, order.user,  ACC_TYPE_USER, challenge_iter->challenge_date});
+        SEND_RECEIPT(*this, orderassrec, { order_id, { {-user_lock, OrderReceiptChallengeReq}}, order.user,  ACC_TYPE_USER, challenge_iter->challenge_date});
     }
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { *challenge_iter });
+    order_receipt(*order_iter, 2);
+    challenge_receipt(*challenge_iter);
 }
 
 void token::anschallenge(name sender, uint64_t order_id, checksum256 reply_hash)
@@ -177,12 +163,12 @@ void token::anschallenge(name sender, uint64_t order_id, checksum256 reply_hash)
 
     check(get_challenge_state(order_id) == ChallengeRequest, "invalid state, cannot reply");
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(sender == order_iter->miner, "only miner can reply proof");
 
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
     auto reply_bytes = reply_hash.extract_as_byte_array();
@@ -190,32 +176,32 @@ void token::anschallenge(name sender, uint64_t order_id, checksum256 reply_hash)
 
     check(checksum_data == challenge_iter->hash_data, "invalid reply hash data");
 
-    auto per_price_amount = double(order_iter->price.quantity.amount) * 0.1 / (order_iter->miner_lock_pst.quantity.amount / pow(10, pst_sym.get_symbol().precision()));
-    auto user_pay = extended_asset(per_price_amount, order_iter->price.get_extended_symbol());
+    auto per_price_amount = double(order_iter->price) * 0.1 / (order_iter->miner_lock_pst / pow(10, pst_sym.get_symbol().precision()));
+    auto user_pay = extended_asset(per_price_amount, dmc_sym);
     if (challenge_iter->challenger == get_self()){
-        user_pay = extended_asset(0,  order_iter->price.get_extended_symbol());
+        user_pay = extended_asset(0,  dmc_sym);
     }
 
-    auto order = *order_iter;
+    dmc_order order = *order_iter;
     order.user_pledge += challenge_iter->user_lock - user_pay;
     if ((challenge_iter->user_lock - user_pay).quantity.amount != 0) {
-        SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order_id, {{challenge_iter->user_lock - user_pay, OrderReceiptChallengeAns}}, order.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
+        SEND_RECEIPT(*this, orderassrec, { order_id, {{challenge_iter->user_lock - user_pay, OrderReceiptChallengeAns}}, order.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
     }
 
     increase_penalty(user_pay);
 
-    challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+    modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
         c.state = ChallengeAnswer;
         c.user_lock = extended_asset(0, dmc_sym);
         c.miner_pay += user_pay;
     });
 
     update_order(order, *challenge_iter, sender);
-    order_tbl.modify(order_iter, sender, [&](auto& o) {
+    modify_row(order_tbl, order_iter, sender, [&](auto& o) {
         o = order;
     });
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { *challenge_iter });
+    order_receipt(*order_iter, 2);
+    challenge_receipt(*challenge_iter);
 }
 
 void token::arbitration(name sender, uint64_t order_id, const std::vector<char>& data, std::vector<checksum256> cut_merkle)
@@ -224,11 +210,11 @@ void token::arbitration(name sender, uint64_t order_id, const std::vector<char>&
 
     check(get_challenge_state(order_id) == ChallengeRequest, "invalid state, cannot arbitration");
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
 
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
     std::vector<char> copy_data = data;
@@ -257,11 +243,11 @@ void token::arbitration(name sender, uint64_t order_id, const std::vector<char>&
     }
     check(checksum_data == challenge_iter->merkle_root, "merkle root mismatch!");
 
-    auto per_price_amount = double(order_iter->price.quantity.amount) * 0.1 / (order_iter->miner_lock_pst.quantity.amount / pow(10, pst_sym.get_symbol().precision()));
-    auto miner_pay = extended_asset(per_price_amount, order_iter->price.get_extended_symbol());
-    auto user_pay = extended_asset(per_price_amount * 100, order_iter->price.get_extended_symbol());
+    auto per_price_amount = double(order_iter->price) * 0.1 / (order_iter->miner_lock_pst / pow(10, pst_sym.get_symbol().precision()));
+    auto miner_pay = extended_asset(per_price_amount, dmc_sym);
+    auto user_pay = extended_asset(per_price_amount * 100, dmc_sym);
     if (challenge_iter->challenger == get_self()){
-        user_pay = extended_asset(0, order_iter->price.get_extended_symbol());
+        user_pay = extended_asset(0, dmc_sym);
     }
 
     ChallengeState state = ChallengeArbitrationUserPay;
@@ -272,15 +258,15 @@ void token::arbitration(name sender, uint64_t order_id, const std::vector<char>&
         user_pay = tmp;
     }
 
-    auto order = *order_iter;
+    dmc_order order = *order_iter;
     order.user_pledge += challenge_iter->user_lock - user_pay;
 
     increase_penalty(user_pay);
     if ((challenge_iter->user_lock - user_pay).quantity.amount != 0) {
-        SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order_id, { {challenge_iter->user_lock - user_pay, OrderReceiptChallengeArb} }, order.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
+        SEND_RECEIPT(*this, orderassrec, { order_id, { {challenge_iter->user_lock - user_pay, OrderReceiptChallengeArb} }, order.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
     }
     
-    challenge_tbl.modify(challenge_iter, sender, [&](auto& o) {
+    modify_row(challenge_tbl, challenge_iter, sender, [&](auto& o) {
         o.state = state;
         o.user_lock = extended_asset(0, dmc_sym);
         o.miner_pay += miner_pay;
@@ -288,11 +274,11 @@ void token::arbitration(name sender, uint64_t order_id, const std::vector<char>&
 
     update_order(order, *challenge_iter, sender);
 
-    order_tbl.modify(order_iter, sender, [&](auto& o) {
+    modify_row(order_tbl, order_iter, sender, [&](auto& o) {
         o = order;
     });
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { *challenge_iter });
+    order_receipt(*order_iter, 2);
+    challenge_receipt(*challenge_iter);
 }
 
 void token::paychallenge(name sender, uint64_t order_id)
@@ -300,11 +286,11 @@ void token::paychallenge(name sender, uint64_t order_id)
     require_auth(sender);
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     uint64_t challenge_interval = get_dmc_config("challinter"_n, default_dmc_challenge_interval);
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
     check(challenge_iter->state == ChallengeRequest, "invalid state, can't pay challenge!");
@@ -318,18 +304,18 @@ void token::paychallenge(name sender, uint64_t order_id)
     
     add_balance(order_info.user,  (miner_arbitration - system_reward) + order_info.deposit, sender);
     if (order_info.deposit.quantity.amount > 0) {
-         SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
+         SEND_RECEIPT(*this, assetrec, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
          order_info.deposit = extended_asset(0, order_info.deposit.get_extended_symbol());
     }
-    SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { miner_arbitration - system_reward }, order_info.user, AssetReceiptPayChallenge});
+    SEND_RECEIPT(*this, assetrec, { order_id, { miner_arbitration - system_reward }, order_info.user, AssetReceiptPayChallenge});
     delete_order_pst(order_info);
     order_info.miner_lock_dmc = extended_asset(0, dmc_sym);
     order_info.lock_pledge -= order_info.price;
     order_info.user_pledge += challenge_iter->user_lock + order_info.price;
     order_info.state = OrderStateEnd;
-    SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order_id, { {order_info.price, OrderReceiptLockRet} }, order_info.user, ACC_TYPE_USER, time_point_sec(current_time_point())});
+    SEND_RECEIPT(*this, orderassrec, { order_id, { {order_info.price, OrderReceiptLockRet} }, order_info.user, ACC_TYPE_USER, time_point_sec(current_time_point())});
     if (challenge_iter->user_lock.quantity.amount != 0) {
-        SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order_id, { {challenge_iter->user_lock, OrderReceiptPayChallengeRet} }, order_info.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
+        SEND_RECEIPT(*this, orderassrec, { order_id, { {challenge_iter->user_lock, OrderReceiptPayChallengeRet} }, order_info.user,  ACC_TYPE_USER, time_point_sec(current_time_point())});
     }
 
     bool deleted = false;
@@ -337,7 +323,7 @@ void token::paychallenge(name sender, uint64_t order_id)
         (!order_info.miner_lock_dmc.quantity.amount) && (!order_info.settlement_pledge.quantity.amount)) {
             if (order_info.user_pledge.quantity.amount) {
                 add_balance(order_info.user, order_info.user_pledge, sender);
-                SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { order_info.user_pledge }, order_info.user, AssetReceiptSubReserve});
+                SEND_RECEIPT(*this, assetrec, { order_id, { order_info.user_pledge }, order_info.user, AssetReceiptSubReserve});
                 order_info.user_pledge = extended_asset(0, order_info.user_pledge.get_extended_symbol());
             }
             deleted = true;
@@ -350,16 +336,17 @@ void token::paychallenge(name sender, uint64_t order_id)
         order_tbl.erase(order_iter);
         challenge_tbl.erase(challenge_iter);
         delete_maker_snapshot(order_id);
+        order_receipt(order_info, 3);
+        challenge_receipt(challenge, true);
     } else {
-        order_tbl.modify(order_iter, sender, [&](auto& o) {
+        modify_row(order_tbl, order_iter, sender, [&](auto& o) {
             o = order_info;
         });
-        challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+        modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
             c = challenge;
         });
+        order_receipt(*order_iter, 2);
+        challenge_receipt(*challenge_iter);
     }
-
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { order_info, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { challenge });
 }
 }
\ No newline at end of file
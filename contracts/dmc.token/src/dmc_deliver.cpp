@@ -15,24 +15,27 @@ void token::delete_order_pst(const dmc_order& order) {
     send_totalvote_to_system(order.miner);
 }
 
-void token::update_order_asset(dmc_order& order, OrderState new_state, uint64_t claims_interval) {
-    maker_snapshot_table  maker_snapshot_tbl(get_self(), get_self().value);
-    auto iter = maker_snapshot_tbl.find(order.order_id);
-    check(iter != maker_snapshot_tbl.end(), "cannot find miner in dmc maker");
+void token::update_order_asset(dmc_order& order, OrderState new_state, uint64_t claims_interval, uint64_t periods) {
+    auto snapshot = get_order_snapshot(order.order_id);
     auto user_rsi = extended_asset(round(double(order.miner_lock_pst.quantity.amount) * pow(10, rsi_sym.get_symbol().precision() - order.miner_lock_pst.get_extended_symbol().get_symbol().precision())), rsi_sym);
-    auto miner_rsi_total = extended_asset(round(user_rsi.quantity.amount * (1 + iter->rate / 100.0)), rsi_sym);
+    auto miner_rsi_total = extended_asset(round(user_rsi.quantity.amount * (1 + snapshot.rate / 100.0)), rsi_sym);
     auto dmc_pledge = extended_asset(order.price.quantity.amount / 2, (order.price.get_extended_symbol()));
     auto miner_rsi_pledge = extended_asset(miner_rsi_total.quantity.amount / 2, (miner_rsi_total.get_extended_symbol()));
-    // SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order.order_id, { {miner_rsi_pledge, OrderReceiptReward}, {dmc_pledge, OrderReceiptClaim}}, order.miner, ACC_TYPE_MINER, order.latest_settlement_date});
-    // SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order.order_id, { {user_rsi, OrderReceiptReward} }, order.user,  ACC_TYPE_USER, order.latest_settlement_date});
-
+    // SEND_RECEIPT(*this, orderassrec, { order.order_id, { {miner_rsi_pledge, OrderReceiptReward}, {dmc_pledge, OrderReceiptClaim}}, order.miner, ACC_TYPE_MINER, order.latest_settlement_date});
+    // SEND_RECEIPT(*this, orderassrec, { order.order_id, { {user_rsi, OrderReceiptReward} }, order.user,  ACC_TYPE_USER, order.latest_settlement_date});
+
+    // every period settles the same amounts
+    user_rsi.quantity *= periods;
+    miner_rsi_total.quantity *= periods;
+    dmc_pledge.quantity *= periods;
+    miner_rsi_pledge.quantity *= periods;
     order.lock_pledge -= dmc_pledge;
     order.settlement_pledge += dmc_pledge;
     order.miner_lock_rsi += miner_rsi_total - miner_rsi_pledge;
     order.miner_rsi += miner_rsi_pledge;
     order.user_rsi += user_rsi;
     order.state = new_state;
-    order.latest_settlement_date += claims_interval;
+    order.latest_settlement_date += claims_interval * periods;
 }
 
 void token::change_order(dmc_order& order, const dmc_challenge& challenge, time_point_sec current, uint64_t claims_interval, name payer)
@@ -57,11 +60,25 @@ void token::change_order(dmc_order& order, const dmc_challenge& challenge, time_
              order.state = OrderStatePreCancel;
              return;
         }
+        // renew and settle at once all the periods that are over and paid for
+        uint64_t periods = (current.sec_since_epoch() - order.latest_settlement_date.sec_since_epoch()) / claims_interval;
+        if (order.price.quantity.amount > 0) {
+            periods = std::min(periods, uint64_t(order.user_pledge.quantity.amount / order.price.quantity.amount));
+        }
+        if (periods > 0) {
+            extended_asset renew = extended_asset(order.price.quantity.amount * periods, order.price.get_extended_symbol());
+            time_point_sec last_renew_date = order.latest_settlement_date + claims_interval * (periods - 1) + per_claims_interval;
+            order.user_pledge -= renew;
+            order.lock_pledge += renew;
+            update_order_asset(order, OrderStateDeliver, claims_interval, periods);
+            SEND_RECEIPT(*this, orderassrec, { order.order_id, { {-renew, OrderReceiptRenew} }, order.user,  ACC_TYPE_USER, last_renew_date});
+            return;
+        }
         if (order.user_pledge >= order.price) {
             order.user_pledge -= order.price;
             order.lock_pledge += order.price;
             order.state = OrderStatePreCont;
-            SEND_INLINE_ACTION(*this, orderassrec, { _self, "active"_n }, { order.order_id, { {-order.price, OrderReceiptRenew} }, order.user,  ACC_TYPE_USER, order.latest_settlement_date + per_claims_interval});
+            SEND_RECEIPT(*this, orderassrec, { order.order_id, { {-order.price, OrderReceiptRenew} }, order.user,  ACC_TYPE_USER, order.latest_settlement_date + per_claims_interval});
         } else {
             order.state = OrderStatePreEnd;
         }
@@ -83,7 +100,7 @@ void token::change_order(dmc_order& order, const dmc_challenge& challenge, time_
                 rewards.push_back({order.deposit, AssetReceiptDeposit});
             } else {
                 add_balance(order.user, order.deposit, payer);
-                SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order.order_id, { order.deposit }, order.user, AssetReceiptDeposit});
+                SEND_RECEIPT(*this, assetrec, { order.order_id, { order.deposit }, order.user, AssetReceiptDeposit});
             }
         }
         distribute_lp_pool(order.order_id, rewards,extended_asset(0, dmc_sym), payer);
@@ -102,7 +119,7 @@ void token::change_order(dmc_order& order, const dmc_challenge& challenge, time_
                 rewards.push_back({order.deposit, AssetReceiptDeposit});
             } else {
                 add_balance(order.user, order.deposit, payer);
-                SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order.order_id, { order.deposit }, order.user, AssetReceiptDeposit});
+                SEND_RECEIPT(*this, assetrec, { order.order_id, { order.deposit }, order.user, AssetReceiptDeposit});
             }
         }
         distribute_lp_pool(order.order_id, rewards,extended_asset(0, dmc_sym), payer);
@@ -116,11 +133,9 @@ void token::change_order(dmc_order& order, const dmc_challenge& challenge, time_
         if ( order.lock_pledge.quantity.amount == 0) {
             return;
         } 
-        maker_snapshot_table  maker_snapshot_tbl(get_self(), get_self().value);
-        auto iter = maker_snapshot_tbl.find(order.order_id);
-        check(iter != maker_snapshot_tbl.end(), "cannot find miner in dmc maker");
+        auto snapshot = get_order_snapshot(order.order_id);
         auto user_rsi = extended_asset(round(double(order.miner_lock_pst.quantity.amount) * pow(10, rsi_sym.get_symbol().precision() - order.miner_lock_pst.get_extended_symbol().get_symbol().precision())), rsi_sym);
-        auto miner_rsi_pledge = extended_asset(round(user_rsi.quantity.amount * (1 + iter->rate / 100.0)) / 2, rsi_sym);
+        auto miner_rsi_pledge = extended_asset(round(user_rsi.quantity.amount * (1 + snapshot.rate / 100.0)) / 2, rsi_sym);
         
         if (order.lock_pledge >= dmc_pledge) {
             order.lock_pledge -= dmc_pledge;
@@ -155,69 +170,201 @@ void token::update_order(dmc_order& order, const dmc_challenge& challenge, name
     }
 }
 
+token::dmc_orders::const_iterator token::find_order(dmc_orders& order_tbl, uint64_t order_id)
+{
+    auto order_iter = order_tbl.find(order_id);
+    if (order_iter != order_tbl.end()) {
+        // the base of the next orderdelta
+        _order_bases.emplace(order_id, std::make_pair(dmc_order(*order_iter), order_iter->updates.value_or()));
+        return order_iter;
+    }
+    // an order placed before dmc_order_v2 is moved over the first time it is used
+    dmc_orders_v1 old_order_tbl(get_self(), get_self().value);
+    auto old_order_iter = old_order_tbl.find(order_id);
+    if (old_order_iter == old_order_tbl.end()) {
+        return order_iter;
+    }
+    // the user paid for the old row when ordering; the user or miner signing pays for the compact one,
+    // an order moved by someone else, as by migrateorder, is left on the contract
+    name payer = has_auth(old_order_iter->user) ? old_order_iter->user : has_auth(old_order_iter->miner) ? old_order_iter->miner : get_self();
+    order_iter = order_tbl.emplace(payer, [&](auto& o) {
+        o = *old_order_iter;
+    });
+    old_order_tbl.erase(old_order_iter);
+    _order_bases.emplace(order_id, std::make_pair(dmc_order(*order_iter), order_iter->updates.value_or()));
+    return order_iter;
+}
+
+token::dmc_challenges::const_iterator token::find_challenge(dmc_challenges& challenge_tbl, uint64_t order_id)
+{
+    auto challenge_iter = challenge_tbl.find(order_id);
+    if (challenge_iter != challenge_tbl.end()) {
+        // the base of the next chaldelta
+        _challenge_bases.emplace(order_id, *challenge_iter);
+    }
+    return challenge_iter;
+}
+
+void token::migrateorder(uint64_t limit) {
+    require_auth(dmc_account);
+    // move ${limit} orders at a time to the compact dmc_order_v2 table
+    dmc_orders order_tbl(get_self(), get_self().value);
+    dmc_orders_v1 old_order_tbl(get_self(), get_self().value);
+    for (uint64_t count = 0; old_order_tbl.begin() != old_order_tbl.end() && count < limit; count++) {
+        find_order(order_tbl, old_order_tbl.begin()->order_id);
+    }
+}
+
 void token::generate_maker_snapshot(uint64_t order_id, uint64_t bill_id, name miner, name payer, uint64_t r, bool reset) {
     dmc_makers maker_tbl(get_self(), get_self().value);
     auto maker_iter = maker_tbl.find(miner.value);
     check(maker_iter != maker_tbl.end(), "can't find maker pool");
 
+    // orders share one lp snapshot until the pool changes, see expire_lp_snapshot
+    lp_version_table version_tbl(get_self(), get_self().value);
+    lp_snapshot_table lp_snapshot_tbl(get_self(), get_self().value);
     dmc_maker_pool dmc_pool(get_self(), miner.value);
-    std::vector<maker_lp_pool> lps;
-    std::vector<maker_pool> changed;
-    for (auto iter = dmc_pool.begin(); iter != dmc_pool.end(); iter++) {
-        lps.emplace_back(maker_lp_pool{
-            .owner = iter->owner,
-            .ratio = iter->weight / maker_iter->total_weight,
-        });
-        // if maker pool is empty, set all maker pool weight to 0
-        if (reset) {
-            dmc_pool.modify(iter, payer, [&](auto& m) {
-                m.weight = 0;
+    auto version_iter = version_tbl.find(miner.value);
+    uint64_t version = 0;
+    if (version_iter == version_tbl.end()) {
+        version = get_dmc_config("lpsnapid"_n, default_id_start);
+        lp_snapshot lp_info = {
+            .version = version,
+            .miner = miner,
+            .refs = 1,
+        };
+        for (auto iter = dmc_pool.begin(); iter != dmc_pool.end(); iter++) {
+            lp_info.lps.emplace_back(maker_lp_pool{
+                .owner = iter->owner,
+                .ratio = iter->weight / maker_iter->total_weight,
             });
-            changed.push_back(*iter);
         }
+        lp_snapshot_tbl.emplace(get_self(), [&](auto& s) {
+            s = lp_info;
+        });
+        version_tbl.emplace(get_self(), [&](auto& v) {
+            v.miner = miner;
+            v.version = version;
+        });
+        set_dmc_config("lpsnapid"_n, version + 1);
+        SEND_RECEIPT(*this, lpsnaprec, { lp_info });
+    } else {
+        version = version_iter->version;
+        lp_snapshot_tbl.modify(lp_snapshot_tbl.require_find(version, "lp snapshot not exists"), get_self(), [&](auto& s) {
+            s.refs += 1;
+        });
     }
 
-    maker_snapshot snapshot_info = {
+    order_snapshot snapshot_info = {
         .order_id = order_id,
         .miner = maker_iter->miner,
         .bill_id = bill_id,
         .rate = r,
-        .lps = lps
+        .version = version,
     };
 
-    maker_snapshot_table  maker_snapshot_tbl(get_self(), get_self().value);
-    check(maker_snapshot_tbl.find(order_id) == maker_snapshot_tbl.end(), "order snapshot already exists");
-    maker_snapshot_tbl.emplace(payer, [&](auto& mst) {
-        mst = snapshot_info;
+    order_snapshot_table order_snapshot_tbl(get_self(), get_self().value);
+    check(order_snapshot_tbl.find(order_id) == order_snapshot_tbl.end(), "order snapshot already exists");
+    order_snapshot_tbl.emplace(payer, [&](auto& ost) {
+        ost = snapshot_info;
     });
-    SEND_INLINE_ACTION(*this, makersnaprec, { _self, "active"_n }, { snapshot_info });
-    if(reset) {
-        SEND_INLINE_ACTION(*this, makerpoolrec, {_self, "active"_n}, {miner, changed});
+    SEND_RECEIPT(*this, ordsnaprec, { snapshot_info });
+
+    // if maker pool is empty, set all maker pool weight to 0
+    if (reset) {
+        std::vector<maker_pool> changed;
+        for (auto iter = dmc_pool.begin(); iter != dmc_pool.end(); iter++) {
+            dmc_pool.modify(iter, payer, [&](auto& m) {
+                m.weight = 0;
+            });
+            changed.push_back(*iter);
+        }
+        expire_lp_snapshot(miner);
+        SEND_RECEIPT(*this, makerpoolrec, {miner, changed});
     }
 }
 
 void token::delete_maker_snapshot(uint64_t order_id) {
-    maker_snapshot_table  maker_snapshot_tbl(get_self(), get_self().value);
-    auto snapshot_iter = maker_snapshot_tbl.find(order_id);
-    if (snapshot_iter != maker_snapshot_tbl.end()) {
-        maker_snapshot_tbl.erase(snapshot_iter);
+    order_snapshot_table order_snapshot_tbl(get_self(), get_self().value);
+    auto snapshot_iter = order_snapshot_tbl.find(order_id);
+    if (snapshot_iter == order_snapshot_tbl.end()) {
+        maker_snapshot_table maker_snapshot_tbl(get_self(), get_self().value);
+        auto maker_snapshot_iter = maker_snapshot_tbl.find(order_id);
+        if (maker_snapshot_iter != maker_snapshot_tbl.end()) {
+            maker_snapshot_tbl.erase(maker_snapshot_iter);
+        }
+        return;
     }
+
+    // the last order of an expired lp snapshot takes it along
+    lp_snapshot_table lp_snapshot_tbl(get_self(), get_self().value);
+    lp_version_table version_tbl(get_self(), get_self().value);
+    auto lp_iter = lp_snapshot_tbl.require_find(snapshot_iter->version, "lp snapshot not exists");
+    auto version_iter = version_tbl.find(lp_iter->miner.value);
+    bool current = version_iter != version_tbl.end() && version_iter->version == lp_iter->version;
+    if (lp_iter->refs == 1 && !current) {
+        lp_snapshot_tbl.erase(lp_iter);
+    } else {
+        lp_snapshot_tbl.modify(lp_iter, get_self(), [&](auto& s) {
+            s.refs -= 1;
+        });
+    }
+    order_snapshot_tbl.erase(snapshot_iter);
+}
+
+token::order_snapshot token::get_order_snapshot(uint64_t order_id) {
+    order_snapshot_table order_snapshot_tbl(get_self(), get_self().value);
+    auto snapshot_iter = order_snapshot_tbl.find(order_id);
+    if (snapshot_iter != order_snapshot_tbl.end()) {
+        return *snapshot_iter;
+    }
+    maker_snapshot_table maker_snapshot_tbl(get_self(), get_self().value);
+    auto maker_snapshot_iter = maker_snapshot_tbl.find(order_id);
+    check(maker_snapshot_iter != maker_snapshot_tbl.end(), "order snapshot not exists");
+    return order_snapshot {
+        .order_id = order_id,
+        .miner = maker_snapshot_iter->miner,
+        .bill_id = maker_snapshot_iter->bill_id,
+        .rate = maker_snapshot_iter->rate,
+        .version = 0,
+    };
+}
+
+std::vector<token::maker_lp_pool> token::get_order_lps(const order_snapshot& snapshot) {
+    if (snapshot.version == 0) {
+        maker_snapshot_table maker_snapshot_tbl(get_self(), get_self().value);
+        return maker_snapshot_tbl.get(snapshot.order_id, "order snapshot not exists").lps;
+    }
+    lp_snapshot_table lp_snapshot_tbl(get_self(), get_self().value);
+    return lp_snapshot_tbl.get(snapshot.version, "lp snapshot not exists").lps;
+}
+
+void token::expire_lp_snapshot(name miner) {
+    lp_version_table version_tbl(get_self(), get_self().value);
+    auto version_iter = version_tbl.find(miner.value);
+    if (version_iter == version_tbl.end()) {
+        return;
+    }
+    lp_snapshot_table lp_snapshot_tbl(get_self(), get_self().value);
+    auto lp_iter = lp_snapshot_tbl.find(version_iter->version);
+    if (lp_iter != lp_snapshot_tbl.end() && lp_iter->refs == 0) {
+        lp_snapshot_tbl.erase(lp_iter);
+    }
+    version_tbl.erase(version_iter);
 }
 
 extended_asset token::distribute_lp_pool(uint64_t order_id, std::vector<asset_type_args> rewards, extended_asset challenge_pledge, name payer) {
-    maker_snapshot_table  maker_snapshot_tbl(get_self(), get_self().value);
-    auto snapshot_iter = maker_snapshot_tbl.find(order_id);
-    check(snapshot_iter != maker_snapshot_tbl.end(), "order snapshot not exists");
+    auto snapshot = get_order_snapshot(order_id);
     check(rewards.size(), "invalid rewards size");
     
     dmc_makers maker_tbl(get_self(), get_self().value);
-    auto miner = snapshot_iter->miner;
+    auto miner = snapshot.miner;
     auto maker_iter = maker_tbl.find(miner.value);
     auto remain_pay = extended_asset(0, rewards[0].quant.get_extended_symbol());
     std::vector<asset_type_args> miner_receipt;
     for (uint64_t i = 0; i < rewards.size(); i++) {
         if (rewards[i].type == AssetReceiptClaim || rewards[i].type == AssetReceiptDeposit || rewards[i].type == AssetReceiptReward) {
-            double current_r = snapshot_iter->rate / 100.0;
+            double current_r = snapshot.rate / 100.0;
             auto miner_dmc_pledge = extended_asset(round(rewards[i].quant.quantity.amount / (current_r + 1.0)), rewards[i].quant.get_extended_symbol());
             rewards[i].quant -= miner_dmc_pledge;
 
@@ -226,7 +373,7 @@ extended_asset token::distribute_lp_pool(uint64_t order_id, std::vector<asset_ty
             if (miner_dmc_pledge.quantity.amount) {
                 add_balance(miner, miner_dmc_pledge, payer);
                 miner_receipt.push_back({miner_dmc_pledge, rewards[i].type});
-                SEND_INLINE_ACTION(*this, assetrec, {_self, "active"_n}, {order_id, {miner_dmc_pledge}, miner, rewards[i].type});
+                SEND_RECEIPT(*this, assetrec, {order_id, {miner_dmc_pledge}, miner, rewards[i].type});
             }
             if (challenge_pay.quantity.amount > 0) {
                 miner_receipt.push_back({-challenge_pay, OrderReceiptChallengeAns});
@@ -236,67 +383,90 @@ extended_asset token::distribute_lp_pool(uint64_t order_id, std::vector<asset_ty
         }
     }
     if (miner_receipt.size() > 0) {
-        SEND_INLINE_ACTION(*this, orderassrec, {_self, "active"_n}, {order_id, miner_receipt, miner, ACC_TYPE_MINER, time_point_sec(current_time_point())});
+        SEND_RECEIPT(*this, orderassrec, {order_id, miner_receipt, miner, ACC_TYPE_MINER, time_point_sec(current_time_point())});
     }
+    // the locked stake is returned apart from the rewards
     extended_asset pledge = extended_asset(0, rewards[0].quant.get_extended_symbol());
+    extended_asset principal = extended_asset(0, rewards[0].quant.get_extended_symbol());
     for (uint64_t i = 0; i < rewards.size(); i++) {
-        pledge += rewards[i].quant;
+        if (rewards[i].type == AssetReceiptMinerLock) {
+            principal += rewards[i].quant;
+        } else {
+            pledge += rewards[i].quant;
+        }
     }
 
     auto sub_pledge = extended_asset(0, pledge.get_extended_symbol());
     std::vector<maker_pool> pool_info;
     std::vector<distribute_maker_snapshot> distribute_info;
-    dmc_maker_pool dmc_pool(get_self(), miner.value);
-    auto total_add = extended_asset(0, pledge.get_extended_symbol());
-
-    auto iter_end = snapshot_iter->lps.end();
-    for (auto iter = snapshot_iter->lps.begin();  iter != iter_end; iter++) {
-        if (iter->owner == miner) {
-            continue;
+    extended_asset new_total = maker_iter->total_staked;
+    double new_weight = maker_iter->total_weight;
+
+    // the locked stake goes back to the lps it was taken from, by their ratios when the order was placed:
+    // as weight at the current share price while they are in the pool, to their account once they left
+    if (principal.quantity.amount > 0) {
+        // a pool the order drained was reset to zero weights, it restarts from the returned stake as increase does
+        if (new_total.quantity.amount == 0 || new_weight <= 0) {
+            new_weight = 0;
         }
-        auto owner_pledge = extended_asset(std::floor(iter->ratio * pledge.quantity.amount), pledge.get_extended_symbol());
-        auto pool_iter = dmc_pool.find(iter->owner.value);
-        if (pool_iter != dmc_pool.end()) {
-            double owner_weight = (double)owner_pledge.quantity.amount / maker_iter->total_staked.quantity.amount * maker_iter->total_weight;
-            dmc_pool.modify(pool_iter, payer, [&](auto& p) {
-                p.weight = p.weight + owner_weight;
-            });
-            pool_info.emplace_back(*pool_iter);
-            distribute_info.push_back({iter->owner, owner_pledge, MakerDistributePool});
+        double weight_per_dmc = new_weight > 0 ? new_weight / new_total.quantity.amount : static_weights / principal.quantity.amount;
+        dmc_maker_pool dmc_pool(get_self(), miner.value);
+        auto give_back = [&](name owner, extended_asset quantity) {
+            auto pool_iter = dmc_pool.find(owner.value);
+            if (pool_iter != dmc_pool.end()) {
+                double owner_weight = quantity.quantity.amount * weight_per_dmc;
+                dmc_pool.modify(pool_iter, payer, [&](auto& p) {
+                    p.weight += owner_weight;
+                });
+                pool_info.emplace_back(*pool_iter);
+                new_total += quantity;
+                new_weight += owner_weight;
+                distribute_info.push_back({owner, quantity, MakerDistributePool});
+            } else {
+                add_balance(owner, quantity, payer);
+                sub_pledge += quantity;
+                distribute_info.push_back({owner, quantity, MakerDistributeAccount});
+            }
+        };
+        auto returned = extended_asset(0, principal.get_extended_symbol());
+        for (const auto& lp : get_order_lps(snapshot)) {
+            auto owner_pledge = extended_asset(std::floor(lp.ratio * principal.quantity.amount), principal.get_extended_symbol());
+            if (lp.owner == miner || owner_pledge.quantity.amount == 0) {
+                continue;
+            }
+            give_back(lp.owner, owner_pledge);
+            returned += owner_pledge;
+        }
+        if (principal > returned) {
+            give_back(miner, principal - returned);
+        }
+        expire_lp_snapshot(miner);
+    }
+
+    // the rewards are restaked without minting weight, so every lp's share of the pool grows with it
+    if (pledge.quantity.amount > 0) {
+        if (new_total.quantity.amount > 0 && new_weight > 0) {
+            new_total += pledge;
+            distribute_info.push_back({miner, pledge, MakerDistributePool});
         } else {
-            add_balance(iter->owner, owner_pledge, payer);
-            sub_pledge += owner_pledge;
-            distribute_info.push_back({iter->owner, owner_pledge, MakerDistributeAccount});
-        }
-        total_add += owner_pledge;
-    }
-    auto owner_pledge = pledge - total_add;
-    auto pool_iter = dmc_pool.find(miner.value);
-    if (pool_iter != dmc_pool.end()) {
-        double owner_weight = (double)owner_pledge.quantity.amount / maker_iter->total_staked.quantity.amount * maker_iter->total_weight;
-        dmc_pool.modify(pool_iter, payer, [&](auto& p) {
-            p.weight = p.weight + owner_weight;
-        });
-        pool_info.emplace_back(*pool_iter);
-        distribute_info.push_back({miner, owner_pledge, MakerDistributePool});
-    } else {
-        add_balance(miner, owner_pledge, payer);
-        sub_pledge += owner_pledge;
-        distribute_info.push_back({miner, owner_pledge, MakerDistributeAccount});
+            add_balance(miner, pledge, payer);
+            sub_pledge += pledge;
+            distribute_info.push_back({miner, pledge, MakerDistributeAccount});
+        }
     }
 
-    extended_asset new_total = maker_iter->total_staked + (pledge - sub_pledge);
-    double weight_change = (double)(pledge - sub_pledge).quantity.amount / maker_iter->total_staked.quantity.amount * maker_iter->total_weight;
     double r = cal_current_rate(new_total, miner, maker_iter->get_real_m());
     maker_tbl.modify(maker_iter, get_self(), [&](auto& m) {
-        m.total_weight = m.total_weight + weight_change;
         m.total_staked = new_total;
+        m.total_weight = new_weight;
         m.current_rate = r;
     });
 
-    SEND_INLINE_ACTION(*this, makerecord, { _self, "active"_n }, { *maker_iter });
-    SEND_INLINE_ACTION(*this, makerpoolrec, { _self, "active"_n }, { miner, pool_info });
-    SEND_INLINE_ACTION(*this, dismakerec, { _self, "active"_n }, { order_id, rewards, sub_pledge, distribute_info });
+    if (pool_info.size() > 0) {
+        SEND_RECEIPT(*this, makerpoolrec, { miner, pool_info });
+    }
+    SEND_RECEIPT(*this, makerecord, { *maker_iter });
+    SEND_RECEIPT(*this, dismakerec, { order_id, rewards, sub_pledge, distribute_info });
     return remain_pay;
 }
 
@@ -304,63 +474,226 @@ void token::updateorder(name payer, uint64_t order_id)
 {
     require_auth(payer);
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     update_order(order_info, *challenge_iter, payer);
 
-    order_tbl.modify(order_iter, payer, [&](auto& o) {
+    modify_row(order_tbl, order_iter, payer, [&](auto& o) {
         o = order_info;
     });
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
+    order_receipt(*order_iter, 2);
+}
+
+void token::settleorders(name payer, uint64_t limit)
+{
+    require_auth(payer);
+    check(limit > 0, "invalid limit");
+    uint64_t claims_interval = get_dmc_config("claiminter"_n, default_dmc_claims_interval);
+    uint64_t due_date = time_point_sec(current_time_point()).sec_since_epoch() - claims_interval * 6 / 7;
+
+    // orders settled before settledate have all been canceled or ended, walk the due ones after it, ${limit} rows at a time.
+    // A walk stopped by limit leaves settlecursor at the next row, so orders update_order can't move yet, as with
+    // an open challenge, don't hold back the ones after them. The walk after the last due order starts over at settledate.
+    dmc_orders order_tbl(get_self(), get_self().value);
+    auto settlement_idx = order_tbl.get_index<"settlement"_n>();
+    uint64_t settle_date = get_dmc_config("settledate"_n, 0);
+    uint64_t cursor = get_dmc_config("settlecursor"_n, 0);
+    uint64_t start_date = cursor > settle_date ? cursor : settle_date;
+    std::vector<uint64_t> due_orders;
+    bool finished = start_date == settle_date;
+    auto settlement_iter = settlement_idx.lower_bound(start_date);
+    uint64_t count = 0;
+    for (; settlement_iter != settlement_idx.end() && count < limit; settlement_iter++, count++) {
+        uint64_t settlement_date = settlement_iter->by_settlement_date();
+        if (settlement_date > due_date) {
+            break;
+        }
+        if (settlement_iter->state == OrderStateCancel || settlement_iter->state == OrderStateEnd) {
+            if (finished) {
+                settle_date = settlement_date;
+            }
+            continue;
+        }
+        finished = false;
+        due_orders.push_back(settlement_iter->order_id);
+    }
+    cursor = 0;
+    if (count == limit && settlement_iter != settlement_idx.end() && settlement_iter->by_settlement_date() <= due_date) {
+        // past the date of the rows visited if they all had the date the walk started at
+        uint64_t next_date = settlement_iter->by_settlement_date();
+        cursor = next_date > start_date ? next_date : next_date + 1;
+    }
+    set_dmc_config("settledate"_n, settle_date);
+    set_dmc_config("settlecursor"_n, cursor);
+
+    dmc_challenges challenge_tbl(get_self(), get_self().value);
+    for (auto order_id : due_orders) {
+        auto order_iter = find_order(order_tbl, order_id);
+        auto challenge_iter = find_challenge(challenge_tbl, order_id);
+        check(challenge_iter != challenge_tbl.end(), "can't find challenge");
+
+        dmc_order order_info = *order_iter;
+        update_order(order_info, *challenge_iter, payer);
+        if (order_info.state == order_iter->state && order_info.latest_settlement_date == order_iter->latest_settlement_date) {
+            continue;
+        }
+        modify_row(order_tbl, order_iter, payer, [&](auto& o) {
+            o = order_info;
+        });
+        order_receipt(*order_iter, 2);
+    }
 }
 
 void token::claimdeposit(name payer, uint64_t order_id) {
     require_auth(payer);
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
-    check(order_iter->deposit.quantity.amount > 0, "no deposit to claim");
+    check(order_iter->deposit > 0, "no deposit to claim");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     update_order(order_info, *challenge_iter, payer);
 
     check(payer == order_iter->user, "only order user can claim deposit");
     check(order_info.deposit_valid <= order_info.latest_settlement_date, "order not reach end, can not deposit");
     add_balance(order_info.user, order_info.deposit, payer);
-    SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
+    SEND_RECEIPT(*this, assetrec, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
     order_info.deposit = extended_asset(0, order_info.deposit.get_extended_symbol());
-    order_tbl.modify(order_iter, payer, [&](auto& o) {
+    modify_row(order_tbl, order_iter, payer, [&](auto& o) {
         o = order_info;
     });
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { order_info, 2 });
+    order_receipt(*order_iter, 2);
 }
 
 void token::claimorder(name payer, uint64_t order_id)
 {
     require_auth(payer);
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     update_order(order_info, *challenge_iter, payer);
     check(order_info.settlement_pledge.quantity.amount > 0, "no settlement pledge to claim");
 
     auto user_dmc = get_dmc_by_vrsi(order_info.user_rsi);
     add_balance(order_info.user, user_dmc, payer);
+    claim_order(order_tbl, order_iter, challenge_tbl, challenge_iter, order_info, get_dmc_by_vrsi(order_info.miner_rsi), payer);
+    SEND_RECEIPT(*this, assetrec, { order_id, { user_dmc }, order_info.user, AssetReceiptClaim});
+}
+
+void token::claimorders(name payer, name owner, AccountType acc_type, uint64_t after, uint64_t limit)
+{
+    require_auth(payer);
+    check(acc_type == ACC_TYPE_USER || acc_type == ACC_TYPE_MINER, "invalid account type");
+    check(limit > 0, "invalid limit");
+
+    // settle the next ${limit} orders of owner after order ${after} and exchange the rsi of the ones with
+    // something to claim in one go. An order with nothing to claim keeps what update_order did to it, its
+    // renewal or end is not run again by the next call. The next call resumes after the last order visited.
+    dmc_orders order_tbl(get_self(), get_self().value);
+    dmc_challenges challenge_tbl(get_self(), get_self().value);
+    std::vector<dmc_order> orders;
+    extended_asset total_rsi = extended_asset(0, rsi_sym);
+    uint64_t visited = 0;
+    auto settle = [&](uint64_t order_id) {
+        visited++;
+        auto order_iter = find_order(order_tbl, order_id);
+        auto challenge_iter = find_challenge(challenge_tbl, order_id);
+        check(challenge_iter != challenge_tbl.end(), "can't find challenge");
+        dmc_order order_info = *order_iter;
+        update_order(order_info, *challenge_iter, payer);
+        if (order_info.settlement_pledge.quantity.amount > 0) {
+            total_rsi += order_info.user_rsi + order_info.miner_rsi;
+            orders.push_back(order_info);
+        } else if (order_info.state != order_iter->state || order_info.latest_settlement_date != order_iter->latest_settlement_date) {
+            modify_row(order_tbl, order_iter, payer, [&](auto& o) {
+                o = order_info;
+            });
+            order_receipt(*order_iter, 2);
+        }
+    };
+    auto settle_orders = [&](auto& idx, auto owner_of) {
+        for (auto iter = idx.lower_bound(dmc_order_v2::get_owner_id(owner, after + 1)); iter != idx.end() && owner_of(*iter) == owner && visited < limit; iter++) {
+            settle(iter->order_id);
+        }
+    };
+    // orders not yet moved to dmc_order_v2 come once the owner's orders in it have all been visited,
+    // find_order moves them over and out of the old table, so the next call starts from its first one again
+    auto settle_old_orders = [&](auto& old_idx, auto owner_of) {
+        std::vector<uint64_t> old_order_ids;
+        for (auto iter = old_idx.lower_bound(owner.value); iter != old_idx.end() && owner_of(*iter) == owner && visited + old_order_ids.size() < limit; iter++) {
+            old_order_ids.push_back(iter->order_id);
+        }
+        for (auto order_id : old_order_ids) {
+            settle(order_id);
+        }
+    };
+
+    dmc_orders_v1 old_order_tbl(get_self(), get_self().value);
+    if (acc_type == ACC_TYPE_USER) {
+        auto user_idx = order_tbl.get_index<"user"_n>();
+        settle_orders(user_idx, [](const auto& o) { return o.user; });
+        auto old_user_idx = old_order_tbl.get_index<"user"_n>();
+        settle_old_orders(old_user_idx, [](const auto& o) { return o.user; });
+    } else {
+        auto miner_idx = order_tbl.get_index<"miner"_n>();
+        settle_orders(miner_idx, [](const auto& o) { return o.miner; });
+        auto old_miner_idx = old_order_tbl.get_index<"miner"_n>();
+        settle_old_orders(old_miner_idx, [](const auto& o) { return o.miner; });
+    }
+    check(visited > 0, "no order to claim");
+    if (orders.size() == 0) {
+        return;
+    }
+
+    // share the exchanged dmc by rsi, the last share takes the rounding remainder
+    extended_asset total_dmc = get_dmc_by_vrsi(total_rsi);
+    extended_asset remain_dmc = total_dmc;
+    auto get_share = [&](const extended_asset& rsi, bool last) {
+        if (last) {
+            return remain_dmc;
+        }
+        auto share = extended_asset(total_rsi.quantity.amount ? int64_t(uint128_t(total_dmc.quantity.amount) * rsi.quantity.amount / total_rsi.quantity.amount) : 0, dmc_sym);
+        remain_dmc -= share;
+        return share;
+    };
+
+    std::map<name, extended_asset> user_claims;
+    for (uint64_t i = 0; i < orders.size(); i++) {
+        auto& order_info = orders[i];
+        auto user_dmc = get_share(order_info.user_rsi, false);
+        auto miner_dmc = get_share(order_info.miner_rsi, i + 1 == orders.size());
+        auto claim_iter = user_claims.emplace(order_info.user, extended_asset(0, dmc_sym)).first;
+        claim_iter->second += user_dmc;
+
+        auto order_iter = order_tbl.find(order_info.order_id);
+        auto challenge_iter = find_challenge(challenge_tbl, order_info.order_id);
+        claim_order(order_tbl, order_iter, challenge_tbl, challenge_iter, order_info, miner_dmc, payer);
+    }
+
+    for (auto& claim : user_claims) {
+        add_balance(claim.first, claim.second, payer);
+        SEND_RECEIPT(*this, assetrec, { 0, { claim.second }, claim.first, AssetReceiptClaim});
+    }
+}
+
+void token::claim_order(dmc_orders& order_tbl, dmc_orders::const_iterator order_iter, dmc_challenges& challenge_tbl, dmc_challenges::const_iterator challenge_iter, dmc_order& order_info, extended_asset miner_dmc, name payer)
+{
+    uint64_t order_id = order_info.order_id;
     auto challenge = *challenge_iter;
-    auto miner_remain_pay = distribute_lp_pool(order_info.order_id, {{order_info.settlement_pledge, AssetReceiptClaim}, {get_dmc_by_vrsi(order_info.miner_rsi), AssetReceiptReward}}, challenge.miner_pay, payer);
+    auto miner_remain_pay = distribute_lp_pool(order_info.order_id, {{order_info.settlement_pledge, AssetReceiptClaim}, {miner_dmc, AssetReceiptReward}}, challenge.miner_pay, payer);
     challenge.miner_pay = miner_remain_pay;
 
     order_info.user_rsi = extended_asset(0, order_info.user_rsi.get_extended_symbol());
@@ -369,7 +702,7 @@ void token::claimorder(name payer, uint64_t order_id)
 
     if (order_info.deposit_valid <= order_info.latest_settlement_date && order_info.deposit.quantity.amount > 0) {
         add_balance(order_info.user, order_info.deposit, payer);
-        SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
+        SEND_RECEIPT(*this, assetrec, { order_id, { order_info.deposit }, order_info.user, AssetReceiptDeposit});
         order_info.deposit = extended_asset(0, order_info.deposit.get_extended_symbol());
     }
 
@@ -380,7 +713,7 @@ void token::claimorder(name payer, uint64_t order_id)
         (!order_info.deposit.quantity.amount) && (!order_info.miner_lock_dmc.quantity.amount)) {
             if (order_info.user_pledge.quantity.amount) {
                 add_balance(order_info.user, order_info.user_pledge, payer);
-                SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { order_info.user_pledge }, order_info.user, AssetReceiptSubReserve});
+                SEND_RECEIPT(*this, assetrec, { order_id, { order_info.user_pledge }, order_info.user, AssetReceiptSubReserve});
                 order_info.user_pledge = extended_asset(0, order_info.user_pledge.get_extended_symbol());
             }
             deleted = true;
@@ -390,18 +723,18 @@ void token::claimorder(name payer, uint64_t order_id)
         order_tbl.erase(order_iter);
         challenge_tbl.erase(challenge_iter);
         delete_maker_snapshot(order_id);
+        order_receipt(order_info, 3);
+        challenge_receipt(challenge, true);
     } else {
-        order_tbl.modify(order_iter, payer, [&](auto& o) {
+        modify_row(order_tbl, order_iter, payer, [&](auto& o) {
             o = order_info;
         });
-        challenge_tbl.modify(challenge_iter, payer, [&](auto& c) {
+        modify_row(challenge_tbl, challenge_iter, payer, [&](auto& c) {
             c = challenge;
         });
+        order_receipt(*order_iter, 2);
+        challenge_receipt(*challenge_iter);
     }
-
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { order_info, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { challenge });
-    SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n }, { order_id, { user_dmc }, order_info.user, AssetReceiptClaim});
 }
 
 void token::addordasset(name sender, uint64_t order_id, extended_asset quantity)
@@ -409,24 +742,24 @@ void token::addordasset(name sender, uint64_t order_id, extended_asset quantity)
     require_auth(sender);
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(order_iter->user == sender, "only user can add order asset");
 
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     update_order(order_info, *challenge_iter, sender);
 
     sub_balance(sender, quantity);
     order_info.user_pledge += quantity;
 
-    order_tbl.modify(order_iter, sender, [&](auto& o) {
+    modify_row(order_tbl, order_iter, sender, [&](auto& o) {
         o = order_info;
     });
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
+    order_receipt(*order_iter, 2);
 }
 
 void token::subordasset(name sender, uint64_t order_id, extended_asset quantity)
@@ -434,41 +767,41 @@ void token::subordasset(name sender, uint64_t order_id, extended_asset quantity)
     require_auth(sender);
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(order_iter->user == sender, "only user can sub order asset");
 
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     update_order(order_info, *challenge_iter, sender);
 
     check(order_info.user_pledge >= quantity, "not enough user pledge");
     add_balance(sender, quantity, sender);
     order_info.user_pledge -= quantity;
 
-    order_tbl.modify(order_iter, sender, [&](auto& o) {
+    modify_row(order_tbl, order_iter, sender, [&](auto& o) {
         o = order_info;
     });
 
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { *order_iter, 2 });
+    order_receipt(*order_iter, 2);
 }
 
 void token::cancelorder(name sender, uint64_t order_id) {
     require_auth(sender);
 
     dmc_orders order_tbl(get_self(), get_self().value);
-    auto order_iter = order_tbl.find(order_id);
+    auto order_iter = find_order(order_tbl, order_id);
     check(order_iter != order_tbl.end(), "can't find order");
     check(order_iter->miner == sender || order_iter->user == sender, "only miner or user can cancel order");
     
     dmc_challenges challenge_tbl(get_self(), get_self().value);
-    auto challenge_iter = challenge_tbl.find(order_id);
+    auto challenge_iter = find_challenge(challenge_tbl, order_id);
     check(challenge_iter != challenge_tbl.end(), "can't find challenge");
 
-    auto order_info = *order_iter;
+    dmc_order order_info = *order_iter;
     auto challenge_info = *challenge_iter;
     update_order(order_info, challenge_info, sender);
     check(is_challenge_end(challenge_info.state) || challenge_info.state == ChallengePrepare, "invalid challenge state");
@@ -481,8 +814,7 @@ void token::cancelorder(name sender, uint64_t order_id) {
         distribute_lp_pool(order_info.order_id, {{order_info.miner_lock_dmc, AssetReceiptMinerLock}}, extended_asset(0, dmc_sym), get_self());
         delete_order_pst(order_info);
         add_balance(order_info.user, order_info.lock_pledge + order_info.user_pledge + order_info.deposit, sender);
-        SEND_INLINE_ACTION(*this, assetrec, { _self, "active"_n },
-        { order_id, { order_info.lock_pledge, order_info.user_pledge, order_info.deposit }, order_info.user, AssetReceiptCancel});
+        SEND_RECEIPT(*this, assetrec, { order_id, { order_info.lock_pledge, order_info.user_pledge, order_info.deposit }, order_info.user, AssetReceiptCancel});
         order_info.miner_lock_dmc = extended_asset(0, order_info.miner_lock_dmc.get_extended_symbol());
         order_info.lock_pledge = extended_asset(0, order_info.lock_pledge.get_extended_symbol());
         order_info.user_pledge = extended_asset(0, order_info.user_pledge.get_extended_symbol());
@@ -500,16 +832,18 @@ void token::cancelorder(name sender, uint64_t order_id) {
         order_tbl.erase(order_iter);
         challenge_tbl.erase(challenge_iter);
         delete_maker_snapshot(order_id);
+        order_receipt(order_info, 3);
+        challenge_receipt(challenge_info, true);
     } else {
-        order_tbl.modify(order_iter, sender, [&](auto& o) {
+        modify_row(order_tbl, order_iter, sender, [&](auto& o) {
             o = order_info;
         });
-        challenge_tbl.modify(challenge_iter, sender, [&](auto& c) {
+        modify_row(challenge_tbl, challenge_iter, sender, [&](auto& c) {
             c = challenge_info;
         });
+        order_receipt(*order_iter, 2);
+        challenge_receipt(*challenge_iter);
     }
-    SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { order_info, 2 });
-    SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { challenge_info });
 }
 
 }
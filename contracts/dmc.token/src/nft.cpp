@@ -20,7 +20,7 @@ void token::nftcreatesym(extended_symbol nft_symbol, std::string symbol_uri, nft
         n.symbol_uri = symbol_uri;
         n.type = type;
     });
-    SEND_INLINE_ACTION(*this, nftsymrec, { get_self(), "active"_n }, { symbol_id, nft_symbol, symbol_uri, type });
+    SEND_RECEIPT(*this, nftsymrec, { symbol_id, nft_symbol, symbol_uri, type });
 }
 
 void token::nftcreate(name to, std::string nft_uri, std::string nft_name, std::string extra_data, extended_asset quantity)
@@ -53,8 +53,8 @@ void token::nftcreate(name to, std::string nft_uri, std::string nft_name, std::s
         n.nft_id = nft_id;
         n.quantity = quantity;
     });
-    SEND_INLINE_ACTION(*this, nftrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, nft_uri, nft_name, extra_data, quantity });
-    SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, to, quantity });
+    SEND_RECEIPT(*this, nftrec, { symbol_iter->symbol_id, nft_id, nft_uri, nft_name, extra_data, quantity });
+    SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, to, quantity });
 }
 
 void token::nftissue(name to, uint64_t nft_id, extended_asset quantity)
@@ -94,8 +94,8 @@ void token::nftissue(name to, uint64_t nft_id, extended_asset quantity)
             n.quantity += quantity;
         });
     }
-    SEND_INLINE_ACTION(*this, nftrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
-    SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, to, user_quant });
+    SEND_RECEIPT(*this, nftrec, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
+    SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, to, user_quant });
 }
 
 void token::nfttransfer(name from, name to, uint64_t nft_id, extended_asset quantity, std::string memo)
@@ -133,8 +133,8 @@ void token::nfttransfer(name from, name to, uint64_t nft_id, extended_asset quan
             n.quantity += quantity;
         });
     }
-    SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
-    SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, to, to_quant });
+    SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
+    SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, to, to_quant });
 }
 
 void token::nfttransferb(name from, name to, std::vector<nft_batch_args> batch_args, std::string memo)
@@ -179,8 +179,8 @@ void token::nfttransferb(name from, name to, std::vector<nft_batch_args> batch_a
                 n.quantity += quantity;
             });
         }
-        SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
-        SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, to, to_quant });
+        SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
+        SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, to, to_quant });
     }
 }
 
@@ -208,8 +208,8 @@ void token::nftburn(name from, uint64_t nft_id, extended_asset quantity)
         n.supply -= quantity;
     });
 
-    SEND_INLINE_ACTION(*this, nftrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
-    SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
+    SEND_RECEIPT(*this, nftrec, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
+    SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
 }
 
 void token::burnbatch(name from, std::vector<nft_batch_args> batch_args)
@@ -246,8 +246,8 @@ void token::burnbatch(name from, std::vector<nft_batch_args> batch_args)
             n.supply -= quantity;
         });
 
-        SEND_INLINE_ACTION(*this, nftrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
-        SEND_INLINE_ACTION(*this, nftaccrec, { _self, "active"_n }, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
+        SEND_RECEIPT(*this, nftrec, { symbol_iter->symbol_id, nft_id, nft_iter->nft_uri, nft_iter->nft_name, nft_iter->extra_data, nft_iter->supply });
+        SEND_RECEIPT(*this, nftaccrec, { symbol_iter->symbol_id, nft_id, from, from_iter->quantity });
     }
 }
 }
\ No newline at end of file
@@ -7,6 +7,42 @@
 
 namespace eosio {
 
+namespace {
+    template <typename T>
+    const T& delta_value(const T& value)
+    {
+        return value;
+    }
+
+    int64_t delta_value(const extended_asset& value)
+    {
+        return value.quantity.amount;
+    }
+
+    template <typename T>
+    void add_delta(uint32_t& mask, std::vector<char>& values, uint32_t field, const T& value, const T& base)
+    {
+        if (value == base)
+            return;
+        mask |= 1u << field;
+        auto bytes = pack(delta_value(value));
+        values.insert(values.end(), bytes.begin(), bytes.end());
+    }
+} // namespace
+
+void token::flush_receipts()
+{
+    if (_receipts.empty())
+        return;
+    SEND_INLINE_ACTION(*this, batchrec, { _self, "active"_n }, { receipt_version, _receipts });
+    _receipts.clear();
+}
+
+void token::batchrec(uint8_t version, std::vector<receipt_event> events)
+{
+    require_auth(_self);
+}
+
 void token::outreceipt(name owner, extended_asset x, extended_asset y)
 {
     require_auth(_self);
@@ -78,6 +114,16 @@ void token::challengerec(dmc_challenge challenge_info)
     require_auth(_self);
 }
 
+void token::orderdelta(uint64_t order_id, uint32_t mask, std::vector<char> values)
+{
+    require_auth(_self);
+}
+
+void token::chaldelta(uint64_t order_id, uint32_t mask, std::vector<char> values)
+{
+    require_auth(_self);
+}
+
 void token::billsnap(bill_record bill_info)
 {
     require_auth(_self);
@@ -108,6 +154,16 @@ void token::makersnaprec(maker_snapshot maker_snapshot)
     require_auth(_self);
 }
 
+void token::lpsnaprec(lp_snapshot snapshot)
+{
+    require_auth(_self);
+}
+
+void token::ordsnaprec(order_snapshot snapshot)
+{
+    require_auth(_self);
+}
+
 void token::dismakerec(uint64_t order_id, std::vector<asset_type_args> rewards, extended_asset total_sub, std::vector<distribute_maker_snapshot> distribute_info)
 {
     require_auth(_self);
@@ -122,4 +178,96 @@ void token::innerswaprec(extended_asset vrsi, extended_asset dmc)
 {
     require_auth(_self);
 }
+
+bool token::full_receipt_due(uint64_t order_id, uint32_t base, uint32_t updates)
+{
+    // a full row each time the write count of the row passes a multiple of fullrecint, so no order or
+    // challenge goes longer than that on deltas; the order id spreads the full rows of different orders
+    uint64_t interval = get_dmc_config("fullrecint"_n, default_full_receipt_interval);
+    return (order_id + updates) / interval != (order_id + base) / interval;
+}
+
+void token::order_receipt(const dmc_order& order, uint8_t type, uint32_t updates)
+{
+    auto base_iter = _order_bases.find(order.order_id);
+    // a new or deleted order and a new state are always sent in full
+    if (type != 2 || base_iter == _order_bases.end() || base_iter->second.first.state != order.state) {
+        SEND_RECEIPT(*this, orderrec, { order, type });
+        _order_bases[order.order_id] = { order, updates };
+        return;
+    }
+
+    const dmc_order& base = base_iter->second.first;
+    uint32_t mask = 0;
+    std::vector<char> values;
+    add_delta(mask, values, 1, order.user, base.user);
+    add_delta(mask, values, 2, order.miner, base.miner);
+    add_delta(mask, values, 3, order.bill_id, base.bill_id);
+    add_delta(mask, values, 4, order.user_pledge, base.user_pledge);
+    add_delta(mask, values, 5, order.miner_lock_pst, base.miner_lock_pst);
+    add_delta(mask, values, 6, order.miner_lock_dmc, base.miner_lock_dmc);
+    add_delta(mask, values, 7, order.price, base.price);
+    add_delta(mask, values, 8, order.settlement_pledge, base.settlement_pledge);
+    add_delta(mask, values, 9, order.lock_pledge, base.lock_pledge);
+    add_delta(mask, values, 11, order.deliver_start_date, base.deliver_start_date);
+    add_delta(mask, values, 12, order.latest_settlement_date, base.latest_settlement_date);
+    add_delta(mask, values, 13, order.miner_lock_rsi, base.miner_lock_rsi);
+    add_delta(mask, values, 14, order.miner_rsi, base.miner_rsi);
+    add_delta(mask, values, 15, order.user_rsi, base.user_rsi);
+    add_delta(mask, values, 16, order.deposit, base.deposit);
+    add_delta(mask, values, 17, order.epoch, base.epoch);
+    add_delta(mask, values, 18, order.deposit_valid, base.deposit_valid);
+    add_delta(mask, values, 19, order.cancel_date, base.cancel_date);
+    bool full = full_receipt_due(order.order_id, base_iter->second.second, updates);
+    if (mask == 0 && !full)
+        return;
+
+    if (full) {
+        SEND_RECEIPT(*this, orderrec, { order, type });
+    } else {
+        if (get_dmc_config("legacyrec"_n, 0))
+            SEND_INLINE_ACTION(*this, orderrec, { _self, "active"_n }, { order, type });
+        _receipts.push_back({ "orderdelta"_n, pack(std::make_tuple(order.order_id, mask, values)) });
+    }
+    base_iter->second = { order, updates };
+}
+
+void token::challenge_receipt(const dmc_challenge& challenge, bool full)
+{
+    auto base_iter = _challenge_bases.find(challenge.order_id);
+    if (full || base_iter == _challenge_bases.end() || base_iter->second.state != challenge.state) {
+        SEND_RECEIPT(*this, challengerec, { challenge });
+        _challenge_bases[challenge.order_id] = challenge;
+        return;
+    }
+
+    const dmc_challenge& base = base_iter->second;
+    uint32_t mask = 0;
+    std::vector<char> values;
+    add_delta(mask, values, 1, challenge.pre_merkle_root, base.pre_merkle_root);
+    add_delta(mask, values, 2, challenge.pre_data_block_count, base.pre_data_block_count);
+    add_delta(mask, values, 3, challenge.merkle_root, base.merkle_root);
+    add_delta(mask, values, 4, challenge.data_block_count, base.data_block_count);
+    add_delta(mask, values, 5, challenge.merkle_submitter, base.merkle_submitter);
+    add_delta(mask, values, 6, challenge.data_id, base.data_id);
+    add_delta(mask, values, 7, challenge.hash_data, base.hash_data);
+    add_delta(mask, values, 8, challenge.challenge_times, base.challenge_times);
+    add_delta(mask, values, 9, challenge.nonce, base.nonce);
+    add_delta(mask, values, 11, challenge.user_lock, base.user_lock);
+    add_delta(mask, values, 12, challenge.miner_pay, base.miner_pay);
+    add_delta(mask, values, 13, challenge.challenge_date, base.challenge_date);
+    add_delta(mask, values, 14, challenge.challenger, base.challenger);
+    full = full_receipt_due(challenge.order_id, base.updates.value_or(), challenge.updates.value_or());
+    if (mask == 0 && !full)
+        return;
+
+    if (full) {
+        SEND_RECEIPT(*this, challengerec, { challenge });
+    } else {
+        if (get_dmc_config("legacyrec"_n, 0))
+            SEND_INLINE_ACTION(*this, challengerec, { _self, "active"_n }, { challenge });
+        _receipts.push_back({ "chaldelta"_n, pack(std::make_tuple(challenge.order_id, mask, values)) });
+    }
+    base_iter->second = challenge;
+}
 }  // namespace eosio
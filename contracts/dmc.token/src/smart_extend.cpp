@@ -51,4 +51,16 @@ void token::exchange(name owner, extended_asset quantity, extended_asset to, dou
     uniswaporder(owner, quantity, to, price, id, owner);
 }
 
+void token::exroute(name owner, extended_asset quantity, std::vector<extended_symbol> path, extended_asset min_to, string memo)
+{
+    require_auth(owner);
+    check(quantity.quantity.is_valid() && min_to.quantity.is_valid(), "invalid exchange currency");
+    check(quantity.quantity.amount > 0 && min_to.quantity.amount >= 0, "invalid exchange quantity");
+    check(memo.size() <= 256, "memo has more than 256 bytes");
+    check(path.size() >= 2 && path.size() <= max_route_hops + 1, "invalid exchange path");
+    check(path.front() == quantity.get_extended_symbol() && path.back() == min_to.get_extended_symbol(), "exchange path mismatch");
+
+    uniswaproute(owner, quantity, path, min_to, owner);
+}
+
 } /// namespace eosio
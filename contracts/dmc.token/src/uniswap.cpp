@@ -4,6 +4,7 @@
  */
 
 #include <dmc.token/dmc.token.hpp>
+#include <dmc.token/uniswap_math.hpp>
 
 namespace eosio {
 
@@ -52,20 +53,17 @@ void token::addreserves(name owner, extended_asset x, extended_asset y)
 
         extended_asset new_x = m_iter->tokenx + x;
         extended_asset new_y = m_iter->tokeny + y;
-        double real_old_x = get_real_asset(m_iter->tokenx);
-        double real_old_y = get_real_asset(m_iter->tokeny);
-        double real_new_x = get_real_asset(new_x);
-        double real_new_y = get_real_asset(new_y);
-        uint64_t price = real_old_x / real_old_y * std::pow(2, 32);
-        uint64_t new_price = real_new_x / real_new_y * std::pow(2, 32);
-        double div = (double)new_price / (double)price;
-        check(div <= 1.01 && div >= 0.99, "Excessive price volatility");
-
-        SEND_INLINE_ACTION(*this, pricerec, { _self, "active"_n }, { price, new_price });
-        double total = std::sqrt(real_old_x) * std::sqrt(real_old_y);
-        double new_total = std::sqrt(real_new_x) * std::sqrt(real_new_y);
-
-        new_weights = (new_total - total) / total * m_iter->total_weights;
+        uint8_t precision_x = sym_x.get_symbol().precision();
+        uint8_t precision_y = sym_y.get_symbol().precision();
+        uint64_t price = uniswap_math::to_price_t(uniswap_math::price(m_iter->tokenx.quantity.amount, precision_x, m_iter->tokeny.quantity.amount, precision_y));
+        uint64_t new_price = uniswap_math::to_price_t(uniswap_math::price(new_x.quantity.amount, precision_x, new_y.quantity.amount, precision_y));
+        check(uniswap_math::uint128(new_price) * 100 <= uniswap_math::uint128(price) * 101 && uniswap_math::uint128(new_price) * 100 >= uniswap_math::uint128(price) * 99, "Excessive price volatility");
+
+        SEND_RECEIPT(*this, pricerec, { price, new_price });
+        auto total = uniswap_math::liquidity(m_iter->tokenx.quantity.amount, m_iter->tokeny.quantity.amount);
+        auto new_total = uniswap_math::liquidity(new_x.quantity.amount, new_y.quantity.amount);
+
+        new_weights = (double)(new_total - total) / (double)total * m_iter->total_weights;
         check(new_weights > 0, "Invalid new weights");
         check(new_weights / new_weights > 0, "Invalid new weights");
         auto total_weights = m_iter->total_weights + new_weights;
@@ -76,6 +74,7 @@ void token::addreserves(name owner, extended_asset x, extended_asset y)
             s.total_weights = total_weights;
         });
     }
+    update_oracle(market.get(primary));
 
     swap_pool pool(_self, primary);
     auto pool_iter = pool.find(owner.value);
@@ -153,13 +152,24 @@ void token::outreserves(name owner, extended_symbol x, extended_symbol y, double
     check(m_iter->tokenx.quantity.amount >= 0, "negative tokenx amount");
     check(m_iter->tokeny.quantity.amount >= 0, "negative tokeny amount");
     check(m_iter->total_weights >= 0, "negative total weights amount");
-    if (m_iter->total_weights == 0)
+    swap_oracles oracle_tbl(get_self(), get_self().value);
+    if (m_iter->total_weights == 0) {
+        auto oracle_iter = oracle_tbl.find(primary);
+        if (oracle_iter != oracle_tbl.end())
+            oracle_tbl.erase(oracle_iter);
+        oracle_observations observation_tbl(get_self(), get_self().value);
+        auto observation_iter = observation_tbl.lower_bound(oracle_observation::key(primary, 0));
+        while (observation_iter != observation_tbl.end() && observation_iter->id < oracle_observation::key(primary + 1, 0))
+            observation_iter = observation_tbl.erase(observation_iter);
         m_index.erase(m_iter);
+    } else {
+        update_oracle(*m_iter);
+    }
 
     if (rate != 1)
         check(pool_iter->weights / m_iter->total_weights > 0.0001, "The remaining weight is too low");
 
-    SEND_INLINE_ACTION(*this, outreceipt, { _self, "active"_n }, { owner, x_quantity, y_quantity });
+    SEND_RECEIPT(*this, outreceipt, { owner, x_quantity, y_quantity });
     if (owner == system_account) {
         sub_stats(x_quantity);
         sub_stats(y_quantity);
@@ -196,84 +206,156 @@ void token::uniswaporder(name owner, extended_asset quantity, extended_asset to,
         s.tokenx = marketx;
         s.tokeny = markety;
     });
+    update_oracle(*m_iter);
+}
+
+void token::uniswaproute(name owner, extended_asset quantity, const std::vector<extended_symbol>& path, extended_asset min_to, name rampay)
+{
+    swap_market market(get_self(), get_self().value);
+    auto m_index = market.get_index<"bysymbol"_n>();
+
+    // the hops only move the markets, the owner pays once and is paid once
+    extended_asset from = quantity;
+    for (size_t i = 1; i < path.size(); i++) {
+        auto m_iter = m_index.find(uniswap_market::key(path[i - 1], path[i]));
+        check(m_iter != m_index.end(), "this uniswap pair dose not exist");
+
+        auto marketx = m_iter->tokenx;
+        auto markety = m_iter->tokeny;
+        extended_asset to = extended_asset(0, path[i]);
+        extended_asset spread_from, spread_to;
+        if (path[i - 1] == marketx.get_extended_symbol() && path[i] == markety.get_extended_symbol()) {
+            uniswaptrade(owner, marketx, markety, from, to, 0, spread_from, spread_to);
+        } else if (path[i - 1] == markety.get_extended_symbol() && path[i] == marketx.get_extended_symbol()) {
+            uniswaptrade(owner, markety, marketx, from, to, 0, spread_from, spread_to);
+        } else {
+            check(false, "symbol precision mismatch");
+        }
+
+        m_index.modify(m_iter, get_self(), [&](auto& s) {
+            s.tokenx = marketx;
+            s.tokeny = markety;
+        });
+        update_oracle(*m_iter);
+        from = spread_to;
+    }
+    check(from.quantity.amount >= min_to.quantity.amount, "exchange result is less than min_to");
+
+    add_balance(owner, from, rampay);
+    sub_balance(owner, quantity);
+
+    SEND_INLINE_ACTION(*this, uniswapsnap, { _self, "active"_n },
+        { owner, from });
 }
 
 void token::uniswapdeal(name owner, extended_asset& market_from, extended_asset& market_to, extended_asset from, extended_asset to, uint64_t primary, double price, name rampay)
+{
+    uint64_t price_t = price * std::pow(2, 32);
+    extended_asset spread_from, spread_to;
+    uniswaptrade(owner, market_from, market_to, from, to, price_t, spread_from, spread_to);
+
+    add_balance(owner, spread_to, rampay);
+    sub_balance(owner, spread_from);
+
+    SEND_INLINE_ACTION(*this, uniswapsnap, { _self, "active"_n },
+        { owner, spread_to });
+}
+
+void token::uniswaptrade(name owner, extended_asset& market_from, extended_asset& market_to, extended_asset from, extended_asset to, uint64_t price_t, extended_asset& spread_from, extended_asset& spread_to)
 {
     auto from_sym = from.get_extended_symbol();
     auto to_sym = to.get_extended_symbol();
-    double real_market_from = get_real_asset(market_from);
-    double real_market_to = get_real_asset(market_to);
-    double real_market_total = real_market_from * real_market_to;
-    uint64_t min_price = real_market_from / real_market_to * std::pow(2, 32);
-    uint64_t price_t = price * std::pow(2, 32);
-    bool buy = (from.quantity.amount == 0) ? true : false;
-    bool limit = (price_t == 0) ? false : true;
-    bool first = true;
-
-    extended_asset sub_asset = extended_asset(0, from_sym);
-    extended_asset add_asset = extended_asset(0, to_sym);
-    extended_asset from_scrap = extended_asset(0, from_sym);
-    extended_asset to_scrap = extended_asset(0, to_sym);
-    uint64_t new_price_t = uint64_max;
-    double new_price;
-    if (buy) {
-        extended_asset new_to = market_to - to;
-        if (new_to.quantity.amount > 0) {
-            double real_new_to = get_real_asset(new_to);
-            new_price = real_market_total / (real_new_to * real_new_to);
-            new_price_t = new_price * std::pow(2, 32);
-        }
-    } else {
-        extended_asset new_from = market_from + from;
-        double real_new_from = get_real_asset(new_from);
-        new_price = (real_new_from * real_new_from) / real_market_total;
-        new_price_t = new_price * std::pow(2, 32);
-    }
+    uint8_t from_precision = from_sym.get_symbol().precision();
+    uint8_t to_precision = to_sym.get_symbol().precision();
+    auto old_price = uniswap_math::to_price_t(uniswap_math::price(market_from.quantity.amount, from_precision, market_to.quantity.amount, to_precision));
 
-    auto old_price = min_price;
-    price_t = limit ? price_t : new_price_t;
-    min_price = price_t;
-    min_price = std::min(min_price, new_price_t);
-
-    double real_new_from;
-    extended_asset spread_from;
-    double cal_price = std::sqrt(min_price / std::pow(2, 32));
-    if (min_price == new_price_t && min_price != uint64_max)
-        cal_price = std::sqrt(new_price);
-    real_new_from = cal_price * std::sqrt(real_market_total);
-    extended_asset new_market_from = get_asset_by_amount<double, std::round>(real_new_from, from_sym);
-    spread_from = new_market_from - market_from;
-    market_from = new_market_from;
+    int64_t new_from, new_to;
+    uniswap_math::trade(market_from.quantity.amount, from_precision, market_to.quantity.amount, to_precision, from.quantity.amount, to.quantity.amount, price_t, new_from, new_to);
+    check(new_from < uniswap_math::amount_max, "not enough liquidity in uniswap");
 
-    auto real_new_to = real_market_total / real_new_from;
-    auto new_market_to = get_asset_by_amount<double, std::round>(real_new_to, to_sym);
+    extended_asset new_market_from = extended_asset(new_from, from_sym);
+    auto new_market_to = extended_asset(new_to, to_sym);
+    spread_from = new_market_from - market_from;
     auto spread_ex_to = market_to - new_market_to;
-    market_to = new_market_to;
-    auto to_fee = extended_asset(std::ceil(spread_ex_to.quantity.amount * uniswap_fee), spread_ex_to.get_extended_symbol());
-    extended_asset spread_to = spread_ex_to - to_fee;
-    to_scrap += to_fee;
+    auto min_price = uniswap_math::to_price_t(uniswap_math::price(new_market_from.quantity.amount, from_precision, new_market_to.quantity.amount, to_precision));
+
+    // the fee stays in the market
+    auto to_fee = extended_asset(uniswap_math::fee(spread_ex_to.quantity.amount), to_sym);
+    spread_to = spread_ex_to - to_fee;
     check(spread_from.quantity.amount > 0 && spread_to.quantity.amount > 0, "dust attack detected in uniswap");
 
     from -= spread_from;
     to -= spread_ex_to;
     check(from.quantity.amount >= 0 || to.quantity.amount >= 0, "can't sub/add negative asset"); // never happened
 
-    sub_asset += spread_from;
-    add_asset += spread_to;
-
-    SEND_INLINE_ACTION(*this, pricerec, { _self, "active"_n }, { old_price, min_price });
-    SEND_INLINE_ACTION(*this, traderecord, { _self, "active"_n },
-        { owner, dmc_account, spread_from, spread_to, to_fee, 0 });
-
-    add_balance(owner, add_asset, rampay);
-    sub_balance(owner, sub_asset);
+    market_from = new_market_from;
+    market_to = new_market_to + to_fee;
 
-    market_from += from_scrap;
-    market_to += to_scrap;
+    SEND_RECEIPT(*this, pricerec, { old_price, min_price });
+    SEND_RECEIPT(*this, traderecord, { owner, dmc_account, spread_from, spread_to, to_fee, 0 });
+}
 
-    SEND_INLINE_ACTION(*this, uniswapsnap, { _self, "active"_n },
-        { owner, add_asset });
+void token::update_oracle(const uniswap_market& market)
+{
+    time_point_sec now = time_point_sec(current_time_point());
+    int64_t x = market.tokenx.quantity.amount;
+    int64_t y = market.tokeny.quantity.amount;
+    uint8_t precision_x = market.tokenx.quantity.symbol.precision();
+    uint8_t precision_y = market.tokeny.quantity.symbol.precision();
+
+    // the observation rows are only written once an hour, every other update writes the accumulators alone
+    bool sampled = false;
+    auto update = [&](auto& o) {
+        auto sample = o.current(now);
+        o.updated_at = now;
+        o.x_cumulative = sample.x_cumulative;
+        o.y_cumulative = sample.y_cumulative;
+        if (x > 0 && y > 0) {
+            o.x_price = uniswap_math::to_price_t(uniswap_math::price(x, precision_x, y, precision_y));
+            o.y_price = uniswap_math::to_price_t(uniswap_math::price(y, precision_y, x, precision_x));
+        }
+        if (o.sampled_at == time_point_sec() || now >= o.sampled_at + oracle_interval) {
+            if (o.sampled_at != time_point_sec())
+                o.cursor = (o.cursor + 1) % oracle_slots;
+            o.sampled_at = now;
+            sampled = true;
+        }
+    };
+
+    swap_oracles oracle_tbl(get_self(), get_self().value);
+    auto oracle_iter = oracle_tbl.find(market.primary);
+    if (oracle_iter == oracle_tbl.end()) {
+        oracle_iter = oracle_tbl.emplace(get_self(), [&](auto& o) {
+            o.primary = market.primary;
+            o.updated_at = now;
+            o.x_price = 0;
+            o.y_price = 0;
+            o.x_cumulative = 0;
+            o.y_cumulative = 0;
+            o.cursor = 0;
+            o.sampled_at = time_point_sec();
+            update(o);
+        });
+    } else {
+        oracle_tbl.modify(oracle_iter, get_self(), update);
+    }
+    if (!sampled)
+        return;
+
+    oracle_observations observation_tbl(get_self(), get_self().value);
+    uint64_t id = oracle_observation::key(market.primary, oracle_iter->cursor);
+    price_observation observation = oracle_iter->current(now);
+    auto observation_iter = observation_tbl.find(id);
+    if (observation_iter == observation_tbl.end()) {
+        observation_tbl.emplace(get_self(), [&](auto& o) {
+            o.id = id;
+            o.observation = observation;
+        });
+    } else {
+        observation_tbl.modify(observation_iter, get_self(), [&](auto& o) {
+            o.observation = observation;
+        });
+    }
 }
 
 double token::get_real_asset(extended_asset quantity)
@@ -305,19 +387,30 @@ void token::setreserve(name owner, extended_asset dmc_quantity, extended_asset r
 }
 
 extended_asset token::allocation_abo(time_point_sec now_time) {
-    abostats ast(get_self(), get_self().value);
     extended_asset to_user(0, dmc_sym);
+    // the release only depends on the block time, later calls of the action have nothing to release
+    if (_abo_released_at == now_time) {
+        return to_user;
+    }
+    _abo_released_at = now_time;
 
-    for (auto it = ast.begin(); it != ast.end();) {
+    // stages before ${aboustage} are released to users already
+    abostats ast(get_self(), get_self().value);
+    for (auto it = ast.lower_bound(get_dmc_config("aboustage"_n, 0)); it != ast.end();) {
         if (now_time > it->end_at) {
-            if (it->remaining_release.quantity.amount != 0) {
-                extended_asset curr(it->remaining_release.quantity.amount * it->user_rate, dmc_sym);
+            // the remainder of a finished stage is split once, the side that comes last takes what is left
+            if (it->last_user_released_at < it->end_at) {
+                extended_asset curr = it->remaining_release;
+                if (it->last_foundation_released_at < it->end_at) {
+                    curr.quantity.amount = it->remaining_release.quantity.amount * it->user_rate;
+                }
                 to_user += curr;
                 ast.modify(it, get_self(), [&](auto& a) {
                     a.last_user_released_at = it->end_at;
                     a.remaining_release -= curr;
                 });
             }
+            set_dmc_config("aboustage"_n, it->stage + 1);
             it++;
         } else if (now_time < it->start_at) {
             break;
@@ -337,39 +430,94 @@ extended_asset token::allocation_abo(time_point_sec now_time) {
 
     if (to_user.quantity.amount > 0) {
         add_stats(to_user);
-        SEND_INLINE_ACTION(*this, allocrec, {_self, "active"_n}, {to_user, AllocationAbo});
+        SEND_RECEIPT(*this, allocrec, {to_user, AllocationAbo});
     }
     return to_user;
 }
 
 extended_asset token::allocation_penalty(time_point_sec now_time)
 {
-    penaltystats penst(get_self(), get_self().value);
-
     extended_asset to_penalty(0, dmc_sym);
+    if (_penalty_released_at == now_time) {
+        return to_penalty;
+    }
+    _penalty_released_at = now_time;
 
-    for (auto it = penst.begin(); it != penst.end();){
-        if (now_time >= it->end_at) {
-            to_penalty += it->remaining_release;
-            it = penst.erase(it);
-        } else {
-            auto duration_time = now_time.sec_since_epoch() - it->start_at.sec_since_epoch();
-            auto remaining_time = it->end_at.sec_since_epoch() - it->start_at.sec_since_epoch();
-            double per = (double)duration_time / (double)remaining_time;
-            uint64_t total_asset_amount = per * it->remaining_release.quantity.amount;
-            to_penalty.quantity.amount += total_asset_amount;
+    penalty_schedule schedule = get_penalty_schedule(now_time);
+    uint64_t now_time_t = now_time.sec_since_epoch();
+    uint64_t released_at_t = schedule.released_at.sec_since_epoch();
+    if (released_at_t >= now_time_t) {
+        return to_penalty;
+    }
 
-            penst.modify(it, get_self(), [&](auto& p) {
-                p.start_at = now_time;
-                p.remaining_release.quantity.amount -= total_asset_amount;
-            });
-            break;
-        }
+    // the hours ended since the last release, all slots are within penalty_slots hours of it
+    uint64_t hour = released_at_t / hour_sec;
+    for (uint64_t count = 0; (hour + 1) * hour_sec <= now_time_t && count < penalty_slots; hour++, count++) {
+        auto& slot = schedule.slots[hour % penalty_slots];
+        to_penalty.quantity.amount += slot;
+        slot = 0;
+    }
+
+    // the current hour is released in proportion to the time passed
+    hour = now_time_t / hour_sec;
+    auto& slot = schedule.slots[hour % penalty_slots];
+    uint64_t start_t = std::max(released_at_t, hour * hour_sec);
+    double per = (double)(now_time_t - start_t) / (double)((hour + 1) * hour_sec - start_t);
+    uint64_t total_asset_amount = per * slot;
+    to_penalty.quantity.amount += total_asset_amount;
+    slot -= total_asset_amount;
+
+    schedule.released_at = now_time;
+    set_penalty_schedule(schedule);
+    if (to_penalty.quantity.amount > 0) {
+        SEND_RECEIPT(*this, allocrec, { to_penalty, AllocationPenalty });
     }
-    SEND_INLINE_ACTION(*this, allocrec, { _self, "active"_n }, { to_penalty, AllocationPenalty });
     return to_penalty;
 }
 
+token::penalty_schedule token::get_penalty_schedule(time_point_sec now_time)
+{
+    penalty_schedules schedule_tbl(get_self(), get_self().value);
+    auto schedule_iter = schedule_tbl.find(0);
+    if (schedule_iter != schedule_tbl.end()) {
+        return *schedule_iter;
+    }
+
+    // fold the hourly rows of penaltystats into the slots
+    penalty_schedule schedule = {
+        .released_at = now_time,
+        .slots = {},
+    };
+    penaltystats penst(get_self(), get_self().value);
+    auto it = penst.begin();
+    if (it == penst.end()) {
+        return schedule;
+    }
+    schedule.released_at = it->start_at;
+    while (it != penst.end()) {
+        uint64_t hour = (it->end_at.sec_since_epoch() - 1) / hour_sec;
+        schedule.slots[hour % penalty_slots] += it->remaining_release.quantity.amount;
+        it = penst.erase(it);
+    }
+    set_penalty_schedule(schedule);
+    return schedule;
+}
+
+void token::set_penalty_schedule(const penalty_schedule& schedule)
+{
+    penalty_schedules schedule_tbl(get_self(), get_self().value);
+    auto schedule_iter = schedule_tbl.find(0);
+    if (schedule_iter == schedule_tbl.end()) {
+        schedule_tbl.emplace(get_self(), [&](auto& p) {
+            p = schedule;
+        });
+    } else {
+        schedule_tbl.modify(schedule_iter, get_self(), [&](auto& p) {
+            p = schedule;
+        });
+    }
+}
+
 void token::increase_penalty(extended_asset quantity) 
 {
     check(quantity.get_extended_symbol() == dmc_sym, "only DMC can be penalty");
@@ -377,7 +525,7 @@ void token::increase_penalty(extended_asset quantity)
     uint64_t now_time_t = now_time.sec_since_epoch();
     uint64_t nearest_hour_time = now_time.sec_since_epoch() + 3600 - now_time.sec_since_epoch() % 3600;
     uint64_t sec_to_nearest_hour = nearest_hour_time - now_time_t;
-    uint64_t copies = 11;
+    uint64_t copies = penalty_slots - 1;
 
     auto final_end_time = time_point_sec(nearest_hour_time) + eosio::hours(copies);
     uint64_t sec_to_final_end_time = final_end_time.sec_since_epoch() - now_time_t;
@@ -393,41 +541,14 @@ void token::increase_penalty(extended_asset quantity)
     extended_asset dmc_quantity = allocation_penalty(now_time);
     exchange_from_uniswap(dmc_quantity);
 
-    penaltystats penst(get_self(), get_self().value);
-
-    // the first period
-    {
-        auto it = penst.begin();
-        if (it != penst.end()) {
-            penst.modify(it, get_self(), [&](auto& p) {
-                p.remaining_release += real_first_period;
-            });
-        } else {
-            penst.emplace(get_self(), [&](auto& p) {
-                p.start_at = now_time;
-                p.end_at = time_point_sec(nearest_hour_time);
-                p.remaining_release = real_first_period;
-            });
-        }
-    }
-
-    // the other periods
-    for (int i = 0; i < copies; i++) {
-        auto end_time = time_point_sec(nearest_hour_time) + eosio::hours(i + 1);
-        auto start_time = time_point_sec(nearest_hour_time) + eosio::hours(i);
-        auto it = penst.find(end_time.sec_since_epoch());
-        if (it != penst.end()) {
-            penst.modify(it, get_self(), [&](auto& p) {
-                p.remaining_release += other_period;
-            });
-        } else {
-            penst.emplace(get_self(), [&](auto& p) {
-                p.start_at = start_time;
-                p.end_at = end_time;
-                p.remaining_release = other_period;
-            });
-        }
+    // the slot of the current hour, then one per following hour
+    penalty_schedule schedule = get_penalty_schedule(now_time);
+    uint64_t hour = now_time_t / hour_sec;
+    schedule.slots[hour % penalty_slots] += real_first_period.quantity.amount;
+    for (uint64_t i = 1; i <= copies; i++) {
+        schedule.slots[(hour + i) % penalty_slots] += other_period.quantity.amount;
     }
+    set_penalty_schedule(schedule);
 }
 
 extended_asset token::exchange_from_uniswap(extended_asset add_balance) 
@@ -448,28 +569,22 @@ extended_asset token::exchange_from_uniswap(extended_asset add_balance)
     auto rsi_quantity = m_iter->tokenx;
     auto dmc_quantity = m_iter->tokeny;
 
-    // S = rsi x dmc
-    double real_rsi_quantity = get_real_asset(rsi_quantity);
-    double real_dmc_quantity = get_real_asset(dmc_quantity);
-    double real_market_total = real_rsi_quantity * real_dmc_quantity;
-
+    // S = rsi x dmc stays, the pool keeps the rounding
     extended_asset to_user(0, dmc_sym);
     if (add_balance.get_extended_symbol() == rsi_sym) {
-        rsi_quantity += add_balance;
-        real_rsi_quantity = get_real_asset(rsi_quantity);
-        double real_dmc_quantity = real_market_total / real_rsi_quantity;
-        extended_asset new_dmc_quantity = get_asset_by_amount<double, std::round>(real_dmc_quantity, dmc_sym);
-        
+        extended_asset new_rsi_quantity = rsi_quantity + add_balance;
+        extended_asset new_dmc_quantity = extended_asset(uniswap_math::counter_amount(rsi_quantity.quantity.amount, dmc_quantity.quantity.amount, new_rsi_quantity.quantity.amount), dmc_sym);
+
         // DMC need return to user
         to_user = dmc_quantity - new_dmc_quantity;
+        rsi_quantity = new_rsi_quantity;
         dmc_quantity = new_dmc_quantity;
     } else if (add_balance.get_extended_symbol() == dmc_sym) {
-        dmc_quantity += add_balance;
-        real_dmc_quantity = get_real_asset(dmc_quantity);
-        double real_rsi_quantity = real_market_total / real_dmc_quantity;
-        extended_asset new_rsi_quantity = get_asset_by_amount<double, std::round>(real_rsi_quantity, rsi_sym);
+        extended_asset new_dmc_quantity = dmc_quantity + add_balance;
+        extended_asset new_rsi_quantity = extended_asset(uniswap_math::counter_amount(dmc_quantity.quantity.amount, rsi_quantity.quantity.amount, new_dmc_quantity.quantity.amount), rsi_sym);
 
         rsi_quantity = new_rsi_quantity;
+        dmc_quantity = new_dmc_quantity;
     } else {
         check(false, "only RSI and DMC can be added to uniswap market");
     }
@@ -478,7 +593,7 @@ extended_asset token::exchange_from_uniswap(extended_asset add_balance)
         m.tokenx = rsi_quantity;
         m.tokeny = dmc_quantity;
     });
-    SEND_INLINE_ACTION(*this, innerswaprec, { {get_self(), "active"_n} }, { add_balance, to_user });
+    SEND_RECEIPT(*this, innerswaprec, { add_balance, to_user });
     return to_user;
 }
 
@@ -0,0 +1,150 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ *
+ *  The stake an order locks in a maker pool goes back to the lps it was taken from,
+ *  run on the native build of the contract.
+ */
+#include "scenario.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace eosio;
+using namespace eosio::scenario;
+
+namespace {
+
+int failures = 0;
+
+#define EXPECT(cond)                                                       \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+const name pool_miner = "poolminer"_n;
+const name pool_lp = "poollp"_n;
+
+int64_t dmc_balance(name owner)
+{
+    token::accounts acnts(token_account, owner.value);
+    auto idx = acnts.get_index<"byextendedas"_n>();
+    auto it = idx.find(token::account::key(dmc_sym));
+    return it == idx.end() ? 0 : it->balance.quantity.amount;
+}
+
+token::dmc_maker maker()
+{
+    token::dmc_makers maker_tbl(token_account, token_account.value);
+    return maker_tbl.get(pool_miner.value);
+}
+
+double lp_weight(name owner)
+{
+    token::dmc_maker_pool dmc_pool(token_account, pool_miner.value);
+    auto it = dmc_pool.find(owner.value);
+    return it == dmc_pool.end() ? -1 : it->weight;
+}
+
+/**
+ * a miner with 100 PST staking ${miner_stake} DMC and an lp staking ${lp_stake} DMC in its pool,
+ * at a benchmark price of 0.5 an order locks stake/PST * 200% of its PST price
+ */
+uint64_t setup_pool(int64_t miner_stake, int64_t lp_stake)
+{
+    setup_chain();
+    for (auto n : { pool_miner, pool_lp })
+        host::chain().accounts.insert(n.value);
+    push(config_account, "setdmcconfig"_n, "initalprice"_n, uint64_t(50));
+    push(system_account, "exissue"_n, pool_miner, dmc(miner_stake), std::string("dmc"));
+    push(system_account, "exissue"_n, pool_miner, pst(100), std::string("pst"));
+    push(system_account, "exissue"_n, pool_lp, dmc(lp_stake), std::string("dmc"));
+
+    push(pool_miner, "increase"_n, pool_miner, dmc(miner_stake), pool_miner);
+    push(pool_miner, "setmakerrate"_n, pool_miner, 0.5);
+    push(pool_lp, "increase"_n, pool_lp, dmc(lp_stake), pool_miner);
+    // ordered right away, so no bill bonus is staked into the pool before the order
+    push(pool_miner, "bill"_n, pool_miner, pst(100), 0.5, time_point_sec(current_time_point() + days(3650)), uint64_t(1), std::string(""));
+    return cheapest_bill();
+}
+
+uint64_t next_order_id()
+{
+    token::dmc_global dmc_global_tbl(token_account, token_account.value);
+    auto it = dmc_global_tbl.find("orderid"_n.value);
+    return it == dmc_global_tbl.end() ? default_id_start : it->value;
+}
+
+uint64_t order(uint64_t bill_id, int64_t amount)
+{
+    uint64_t order_id = next_order_id();
+    push(user_account, "order"_n, user_account, bill_id, uint64_t(5000), PriceRangeType(NoLimit), uint64_t(24), pst(amount), dmc(1000), std::string(""));
+    return order_id;
+}
+
+int64_t miner_lock(uint64_t order_id)
+{
+    token::dmc_orders order_tbl(token_account, token_account.value);
+    return order_tbl.get(order_id).miner_lock_dmc;
+}
+
+// an lp that redeemed while the order ran gets its part of the locked stake to its account
+void redeemed_lp()
+{
+    auto bill_id = setup_pool(600, 400);
+    auto order_id = order(bill_id, 10);
+    auto lock = miner_lock(order_id);
+    EXPECT(lock > 0);
+
+    auto staked = maker().total_staked.quantity.amount;
+    push(pool_lp, "redemption"_n, pool_lp, 1.0, pool_miner);
+    auto redeemed = staked - maker().total_staked.quantity.amount;
+    EXPECT(lp_weight(pool_lp) < 0);
+    EXPECT(dmc_balance(pool_lp) == 0);
+
+    push(user_account, "cancelorder"_n, user_account, order_id);
+    auto returned = dmc_balance(pool_lp);
+    EXPECT(std::llabs(returned - lock * 4 / 10) <= 1);
+    EXPECT(std::llabs(redeemed + returned - dmc(400).quantity.amount) <= 2);
+    // the miner keeps the rest as weight in its pool
+    EXPECT(std::llabs(maker().total_staked.quantity.amount - (dmc(1000).quantity.amount - redeemed - returned)) <= 1);
+}
+
+// an order that locks the whole stake resets the pool, the returned stake restores the lps' shares
+void drained_pool()
+{
+    auto bill_id = setup_pool(60, 40);
+    auto order_id = order(bill_id, 100);
+    EXPECT(miner_lock(order_id) == dmc(100).quantity.amount);
+    EXPECT(maker().total_staked.quantity.amount == 0);
+    EXPECT(lp_weight(pool_lp) == 0);
+
+    push(user_account, "cancelorder"_n, user_account, order_id);
+    EXPECT(maker().total_staked == dmc(100));
+    EXPECT(std::fabs(maker().total_weight - static_weights) < 1e-6);
+    EXPECT(std::fabs(lp_weight(pool_lp) / maker().total_weight - 0.4) < 1e-6);
+    EXPECT(std::fabs(lp_weight(pool_miner) / maker().total_weight - 0.6) < 1e-6);
+    EXPECT(dmc_balance(pool_miner) == 0);
+    EXPECT(dmc_balance(pool_lp) == 0);
+
+    push(pool_lp, "redemption"_n, pool_lp, 1.0, pool_miner);
+    EXPECT(std::llabs(maker().total_staked.quantity.amount - dmc(60).quantity.amount) <= 1);
+}
+
+} // namespace
+
+int main()
+{
+    redeemed_lp();
+    drained_pool();
+    if (failures) {
+        std::printf("%d failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("all lp pool tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/**
+ *  @file
+ *  @copyright defined in dmc/LICENSE.txt
+ */
+#include <dmc.token/uniswap_math.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace eosio;
+using uniswap_math::uint128;
+
+namespace {
+
+int failures = 0;
+
+#define EXPECT(cond)                                                       \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+struct trade_vector {
+    int64_t from;
+    uint8_t from_precision;
+    int64_t to;
+    uint8_t to_precision;
+    int64_t in;
+    int64_t out;
+    uint64_t limit_price_t;
+    int64_t new_from;
+    int64_t new_to;
+    int64_t fee;
+    uint64_t old_price;
+    uint64_t new_price;
+};
+
+// computed with arbitrary precision integers, pinned so a change of rounding shows up here
+const trade_vector vectors[] = {
+    { 10000000000, 4, 5000000000, 4, 12345678, 0, 0ull, 10012345678, 4993834773, 18496, 8589934592ull, 8611157396ull },
+    { 10000000000, 4, 5000000000, 4, 12345678, 0, 8598524526ull, 10004998751, 4997501874, 7495, 8589934592ull, 8598524525ull },
+    { 123456789012, 4, 98765, 0, 1000000, 0, 0ull, 123457789012, 98765, 0, 536873255987ull, 536877604660ull },
+    { 98765, 0, 123456789012, 4, 17, 0, 0ull, 98782, 123435542577, 63740, 34359588ull, 34371417ull },
+    { 4611686018427387, 4, 4611686018427387, 4, 999999999, 0, 0ull, 4611687018427386, 4611685018427605, 3000000, 4294967296ull, 4294969158ull },
+    { 10000000000, 4, 5000000000, 4, 5000000000, 0, 9019431321ull, 10246950766, 4879500365, 361499, 8589934592ull, 9019431321ull },
+    { 10000000000, 4, 5000000000, 4, 0, 2000000, 0ull, 10004001601, 4998000000, 6000, 8589934592ull, 8596810665ull },
+    { 777777777, 4, 33333333333, 4, 0, 123456789, 100502234ull, 778888094, 33285816152, 142552, 100215903ull, 100502234ull },
+    { 123456789012, 4, 98765, 0, 0, 500, 0ull, 124084971931, 98265, 2, 536873255987ull, 542350680678ull },
+};
+
+// the floating point trade uniswapdeal used before, without a limit price
+void double_trade(const trade_vector& v, int64_t& new_from, int64_t& new_to)
+{
+    double real_from = v.from / std::pow(10, v.from_precision);
+    double real_to = v.to / std::pow(10, v.to_precision);
+    double total = real_from * real_to;
+    double real_new_from;
+    if (v.in == 0) {
+        double real_new_to = (v.to - v.out) / std::pow(10, v.to_precision);
+        real_new_from = std::sqrt(total / (real_new_to * real_new_to)) * std::sqrt(total);
+    } else {
+        real_new_from = (v.from + v.in) / std::pow(10, v.from_precision);
+    }
+    new_from = std::round(real_new_from * std::pow(10, v.from_precision));
+    new_to = std::round(total / real_new_from * std::pow(10, v.to_precision));
+}
+
+void test_sqrt()
+{
+    const uint128 one = 1;
+    EXPECT(uniswap_math::sqrt_floor(0) == 0);
+    EXPECT(uniswap_math::sqrt_floor(1) == 1);
+    EXPECT(uniswap_math::sqrt_floor(15) == 3);
+    EXPECT(uniswap_math::sqrt_floor(16) == 4);
+    EXPECT(uniswap_math::sqrt_ceil(15) == 4);
+    EXPECT(uniswap_math::sqrt_ceil(16) == 4);
+    EXPECT(uniswap_math::sqrt_floor((one << 126) - 1) == 9223372036854775807ull);
+    EXPECT(uniswap_math::sqrt_floor(one << 126) == 9223372036854775808ull);
+    EXPECT(uniswap_math::sqrt_floor((one << 127) + 12345) == 13043817825332782212ull);
+    const uint128 max64 = ~uint64_t(0);
+    EXPECT(uniswap_math::sqrt_floor(max64 * max64) == max64);
+    EXPECT(uniswap_math::sqrt_floor(uniswap_math::uint128_max) == max64);
+    for (uint64_t n = 1; n < 100000; n += 7) {
+        uint128 r = uniswap_math::sqrt_floor(n);
+        EXPECT(r * r <= n && (r + 1) * (r + 1) > n);
+    }
+}
+
+void test_mul_div()
+{
+    const uint128 one = 1;
+    EXPECT(uniswap_math::mul_div(10, 10, 3) == 33);
+    EXPECT(uniswap_math::mul_div(10, 10, 3, true) == 34);
+    EXPECT(uniswap_math::mul_div(10, 9, 3, true) == 30);
+    // products wider than 128 bits
+    EXPECT(uniswap_math::mul_div(one << 100, one << 100, one << 90) == one << 110);
+    EXPECT(uniswap_math::mul_div((one << 127) + 1, 6, 4, true) == (one << 127) + (one << 126) + 2);
+    EXPECT(uniswap_math::mul_div(uniswap_math::uint128_max, uniswap_math::uint128_max, uniswap_math::uint128_max) == uniswap_math::uint128_max);
+    // quotients that do not fit saturate
+    EXPECT(uniswap_math::mul_div(one << 100, one << 100, 3) == uniswap_math::uint128_max);
+    EXPECT(uniswap_math::fee(0) == 0);
+    EXPECT(uniswap_math::fee(1) == 1);
+    EXPECT(uniswap_math::fee(1000) == 3);
+    EXPECT(uniswap_math::fee(1001) == 4);
+}
+
+void test_vectors()
+{
+    for (const auto& v : vectors) {
+        int64_t new_from, new_to;
+        uniswap_math::trade(v.from, v.from_precision, v.to, v.to_precision, v.in, v.out, v.limit_price_t, new_from, new_to);
+        EXPECT(new_from == v.new_from);
+        EXPECT(new_to == v.new_to);
+        EXPECT(uniswap_math::fee(v.to - new_to) == v.fee);
+        EXPECT(uniswap_math::to_price_t(uniswap_math::price(v.from, v.from_precision, v.to, v.to_precision)) == v.old_price);
+        EXPECT(uniswap_math::to_price_t(uniswap_math::price(new_from, v.from_precision, new_to, v.to_precision)) == v.new_price);
+
+        // the market never loses to rounding
+        EXPECT(uint128(new_from) * uint128(new_to) >= uint128(v.from) * uint128(v.to));
+        if (v.in != 0)
+            EXPECT(new_from <= v.from + v.in);
+        else if (v.limit_price_t == 0)
+            EXPECT(new_to <= v.to - v.out);
+        if (v.limit_price_t)
+            EXPECT(uniswap_math::price(new_from, v.from_precision, new_to, v.to_precision) <= v.limit_price_t);
+
+        // and stays within a raw unit of the floating point trade it replaces
+        if (v.limit_price_t == 0) {
+            int64_t double_from, double_to;
+            double_trade(v, double_from, double_to);
+            EXPECT(std::llabs(new_from - double_from) <= 1);
+            EXPECT(std::llabs(new_to - double_to) <= 1);
+        }
+    }
+}
+
+void test_not_enough_liquidity()
+{
+    int64_t new_from, new_to;
+    uniswap_math::trade(10000, 4, 5000, 4, 0, 5000, 0, new_from, new_to);
+    EXPECT(new_from == uniswap_math::amount_max);
+    uniswap_math::trade(10000, 4, 5000, 4, 0, 6000, 0, new_from, new_to);
+    EXPECT(new_from == uniswap_math::amount_max);
+    // a limit price still fills what the market has at that price
+    uniswap_math::trade(10000, 4, 5000, 4, 0, 5000, uint64_t(8) << uniswap_math::price_bits, new_from, new_to);
+    EXPECT(new_from == 20000 && new_to == 2500);
+}
+
+} // namespace
+
+int main()
+{
+    test_sqrt();
+    test_mul_div();
+    test_vectors();
+    test_not_enough_liquidity();
+    if (failures)
+        std::printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}